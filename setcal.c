@@ -5,70 +5,230 @@
 /////   xkubin27, xphamo00, xpetri25, xkalen07   /////
 //////////////////////////////////////////////////////
 
+// a program without jumps can run its commands on POSIX threads, a build keeping the statistics runs sequentially
+// because they are plain counters
+#if defined(SETCAL_THREADS) && !defined(SETCAL_STATS)
+#define _POSIX_C_SOURCE 200809L
+#define THREADED_EXECUTE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <time.h> // for seeding random
+#ifdef THREADED_EXECUTE
+#include <pthread.h>
+#endif
 
 #define DELIM ' '
 #define MAX_STR_LEN 30
 #define MAX_NUM_LINES 1000
+#define LINE_SLOTS (MAX_NUM_LINES + 2)
 #define END_OF_LINE -1
 #define INVALID_INDEX -2
 #define EMPTY_INDEX -3
+#define EMPTY_SLOT -1
+#define INIT_TABLE_SIZE 64
+#define INPUT_BLOCK_SIZE 65536
+#define ARENA_BLOCK_SIZE (1 << 20)
+#define ARENA_ALIGN 16
+#define INIT_ARRAY_CAPACITY 8
+#define BITS_PER_WORD 64
+#define GALLOP_RATIO 16
+#define MATRIX_MAX_NODES 8192
+#define MATRIX_MIN_DEGREE 8
+#define MATRIX_BLOCK_WORDS 8
+
+#define BACKEND_BITMAP 0
+#define BACKEND_SORTED 1
+#define BACKEND_ADAPTIVE 2
+
+#define CHUNK_BITS 16
+#define CHUNK_SIZE (1 << CHUNK_BITS)
+#define CHUNK_WORDS (CHUNK_SIZE / BITS_PER_WORD)
+#define CONTAINER_ARRAY 0
+#define CONTAINER_BITMAP 1
+#define CONTAINER_RUN 2
+#define CONTAINER_KINDS 3
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define SETC_MAGIC "\177SETC\r\n"
+#define SETC_VERSION 1
+#define SETC_BYTE_ORDER 0x01020304u
 
 #define SET_FUNCTIONS_LASTINDEX 9
 #define REL_FUNCTIONS_LASTINDEX 19
 #define COMBINED_FUNCTIONS_LASTINDEX 23
-
-char functions[][14] = {"empty",
-                        "card",
-                        "complement",
-                        "union",
-                        "intersect",
-                        "minus",
-                        "subseteq",
-                        "subset",
-                        "equals",
-                        "reflexive",
-                        "symmetric",
-                        "antisymmetric",
-                        "transitive",
-                        "function",
-                        "domain",
-                        "codomain",
-                        "closure_ref",
-                        "closure_sym",
-                        "closure_trans",
-                        "injective",
-                        "surjective",
-                        "bijective",
-                        "select"};
+#define OP_PRINT_SET 23
+#define OP_PRINT_RELATION 24
+#define OP_INVALID 25
+#define OP_COUNT 26
+#define MAX_OPERANDS 3
+
+// labels as values are a GNU extension, strict ISO builds dispatch through a switch
+#if defined(__GNUC__) && !defined(__STRICT_ANSI__)
+#define COMPUTED_GOTO
+#endif
+
+#define KEYWORD_TABLE_SIZE 64
+#define KEYWORD_MIN_LEN 4
+#define KEYWORD_MAX_LEN 13
+/// perfect hash of the reserved words, the constants were searched for so that no two words collide
+#define KEYWORD_SLOT(first, penultimate, last, len) \
+    (((first) + 4 * (penultimate) + 6 * (last) + (len)) & (KEYWORD_TABLE_SIZE - 1))
 
 // STRUCTURES
 
+/// a reserved word, either a function name or a boolean literal
+typedef struct
+{
+    const char *word; ///< the reserved word, NULL for an unused slot
+    int funcIdx; ///< index of the function in the functions array, -1 for the boolean literals
+} keyword_t;
+
+/// the reserved words placed by their perfect hash, the slots are computed at compile time
+/// and -Woverride-init (part of -Wextra) reports any collision
+const keyword_t keywords[KEYWORD_TABLE_SIZE] = {
+    [KEYWORD_SLOT('e', 't', 'y', 5)] = {"empty", 0},
+    [KEYWORD_SLOT('c', 'r', 'd', 4)] = {"card", 1},
+    [KEYWORD_SLOT('c', 'n', 't', 10)] = {"complement", 2},
+    [KEYWORD_SLOT('u', 'o', 'n', 5)] = {"union", 3},
+    [KEYWORD_SLOT('i', 'c', 't', 9)] = {"intersect", 4},
+    [KEYWORD_SLOT('m', 'u', 's', 5)] = {"minus", 5},
+    [KEYWORD_SLOT('s', 'e', 'q', 8)] = {"subseteq", 6},
+    [KEYWORD_SLOT('s', 'e', 't', 6)] = {"subset", 7},
+    [KEYWORD_SLOT('e', 'l', 's', 6)] = {"equals", 8},
+    [KEYWORD_SLOT('r', 'v', 'e', 9)] = {"reflexive", 9},
+    [KEYWORD_SLOT('s', 'i', 'c', 9)] = {"symmetric", 10},
+    [KEYWORD_SLOT('a', 'i', 'c', 13)] = {"antisymmetric", 11},
+    [KEYWORD_SLOT('t', 'v', 'e', 10)] = {"transitive", 12},
+    [KEYWORD_SLOT('f', 'o', 'n', 8)] = {"function", 13},
+    [KEYWORD_SLOT('d', 'i', 'n', 6)] = {"domain", 14},
+    [KEYWORD_SLOT('c', 'i', 'n', 8)] = {"codomain", 15},
+    [KEYWORD_SLOT('c', 'e', 'f', 11)] = {"closure_ref", 16},
+    [KEYWORD_SLOT('c', 'y', 'm', 11)] = {"closure_sym", 17},
+    [KEYWORD_SLOT('c', 'n', 's', 13)] = {"closure_trans", 18},
+    [KEYWORD_SLOT('i', 'v', 'e', 9)] = {"injective", 19},
+    [KEYWORD_SLOT('s', 'v', 'e', 10)] = {"surjective", 20},
+    [KEYWORD_SLOT('b', 'v', 'e', 9)] = {"bijective", 21},
+    [KEYWORD_SLOT('s', 'c', 't', 6)] = {"select", 22},
+    [KEYWORD_SLOT('t', 'u', 'e', 4)] = {"true", -1},
+    [KEYWORD_SLOT('f', 's', 'e', 5)] = {"false", -1}
+};
+
+/// a block of memory from which the arena hands out allocations
+typedef struct arenaBlock
+{
+    struct arenaBlock *next; ///< next block of the arena
+    size_t size; ///< number of usable bytes in the block
+    size_t used; ///< number of bytes already handed out
+} arenaBlock_t;
+
+/// region allocator owning all objects of the program, everything is released at once
+typedef struct
+{
+    arenaBlock_t *blocks; ///< list of all blocks of the arena
+    arenaBlock_t *current; ///< the block allocations are currently made from
+    void *last; ///< the most recent allocation, it can be grown in place
+    size_t allocations; ///< number of allocations handed out
+    size_t blockCount; ///< number of blocks requested from the system
+    size_t used; ///< number of bytes currently handed out
+    size_t peak; ///< the highest number of bytes handed out at once
+} arena_t;
+
+/// a position in an arena, everything allocated after it can be released at once
+typedef struct
+{
+    arenaBlock_t *block; ///< the block allocations were made from
+    size_t blockUsed; ///< number of bytes already handed out from that block
+    size_t used; ///< number of bytes handed out by the arena
+} arenaMark_t;
+
 /// struct to store universe contents
 typedef struct
 {
-    char **items; ///< array of strings storing contents of a universe
+    char *pool; ///< contiguous pool of all universe strings, each terminated by '\0'
+    int pool_len; ///< number of used bytes in the pool
+    int *offsets; ///< offsets of the universe items in the pool
+    int *lengths; ///< lengths of the universe items
+    int pool_cap; ///< number of allocated bytes in the pool
     int universe_len; ///< number of elements in a universe
+    int universe_cap; ///< number of items the offsets, lengths and hashes arrays have room for
+    unsigned *hashes; ///< precomputed hashes of the universe items
+    int *table; ///< open addressing hash table of indices into items, EMPTY_SLOT marks a free slot
+    int table_size; ///< number of slots in the hash table, always a power of two
 } universe_t;
 
+/// struct to store the contents of the input file
+typedef struct
+{
+    char *data; ///< the entire contents of the file
+    long len; ///< number of bytes in the file
+    long pos; ///< position of the next unread byte
+} input_t;
+
+/// a line of the input found by the line index pass
+typedef struct
+{
+    long start; ///< position of the first character of the line in the input buffer
+    long len; ///< length of the line without the terminating newline
+} line_t;
+
+/// a string read from the input, pointing directly into the input buffer
+typedef struct
+{
+    const char *str; ///< the first character of the string, not terminated by '\0'
+    int len; ///< length of the string
+} token_t;
+
+/// the items of a set falling into one chunk of CHUNK_SIZE universe indices, stored in the smallest of three encodings
+typedef struct
+{
+    int kind; ///< CONTAINER_ARRAY, CONTAINER_BITMAP or CONTAINER_RUN
+    int len; ///< number of values of an array, number of runs of a run container, number of words of a bitmap
+    uint16_t *values; ///< sorted offsets of an array, or the first and the last offset of every run
+    uint64_t *words; ///< the bitmap of the chunk
+} container_t;
+
 /// struct to store a single set
 typedef struct
 {
     int *items; ///< array of indices referring to a universe
     int set_len; ///< length of a set
+    uint64_t *bits; ///< membership bitmap over the universe indices, built on first use, NULL until then
+    uint64_t *sorted; ///< the items packed with their positions (item << 32 | position) in increasing order, built on first use
+    container_t *chunks; ///< adaptive containers, one for every chunk of the universe, built on first use
+    int min; ///< the smallest item, -1 for an empty set
+    int max; ///< the biggest item, -1 for an empty set
+    uint64_t hash; ///< order independent hash of the items, the sum of their mixed values
+    uint64_t signature; ///< Bloom-style signature with one bit set for every item
     long index; ///< index of a line to which a set belongs
 } set_t;
 
+/// a slot of the table of distinct item sequences
+typedef struct
+{
+    uint64_t hash; ///< hash of the item sequence
+    int idx; ///< index of the set or relation owning the sequence, EMPTY_SLOT for a free slot
+} internSlot_t;
+
+/// open addressing table finding the stored set or relation with the same item sequence
+typedef struct
+{
+    internSlot_t *slots; ///< the slots of the table
+    int size; ///< number of slots, always a power of two
+    int count; ///< number of used slots
+} internTable_t;
+
 /// struct to store all sets in the file
 typedef struct
 {
     set_t *sets; ///< array of all sets
     int setList_len; ///< count of all sets
+    int setList_cap; ///< number of sets the array has room for
+    internTable_t intern; ///< the distinct item sequences of the sets, identical sets share them
 } setList_t;
 
 /// indices of the related strings from universe
@@ -78,12 +238,22 @@ typedef struct
     int y; ///< second element in a binary relation
 } relationUnit_t;
 
+/// compressed sparse row index of a relation, its pairs grouped by the first and by the second item
+typedef struct
+{
+    int *rowStart; ///< |U| + 1 offsets into succ, the successors of x are succ[rowStart[x]] .. succ[rowStart[x + 1] - 1]
+    int *succ; ///< the second items grouped by the first item, increasing within every group
+    int *colStart; ///< |U| + 1 offsets into pred, the predecessors of y are pred[colStart[y]] .. pred[colStart[y + 1] - 1]
+    int *pred; ///< the first items grouped by the second item, increasing within every group
+} relIndex_t;
+
 ///struct to store a relationship set
 typedef struct
 {
     relationUnit_t *items; ///< array of binary relations
     int relation_len; ///< count of binary relations
     long index; ///< index of a line to which a relation belongs
+    relIndex_t *csr; ///< adjacency index of the pairs, built on first use, NULL until then
 } relation_t;
 
 /// struct to store all relationships in a file
@@ -91,8 +261,20 @@ typedef struct
 {
     relation_t *relations; ///< array of all relations
     int relationList_len; ///< count of all relations
+    int relationList_cap; ///< number of relations the array has room for
+    internTable_t intern; ///< the distinct item sequences of the relations, identical relations share them
 } relationList_t;
 
+/// properties of a relation seen as a function from a set A to a set B
+typedef struct
+{
+    bool members; ///< every pair maps an item of A to an item of B
+    bool total; ///< every item of A is mapped to something
+    bool functional; ///< no item is mapped to two different items
+    bool injective; ///< no item is mapped to from two different items
+    bool surjective; ///< every item of B is mapped to from something
+} functionFacts_t;
+
 /// struct to store a single command to memory
 typedef struct
 {
@@ -104,102 +286,660 @@ typedef struct
     bool morphed;
 } command_t;
 
+/// struct resolving every line of a file to what it holds, so operands are found without scanning the lists \n
+/// An operand is looked up among the objects stored before it only up to the first one of a later line,
+/// so an object stored after one of a later line is hidden from operands
+typedef struct
+{
+    int command[LINE_SLOTS]; ///< position of the command of every line in the command list, EMPTY_SLOT for none
+    int set[LINE_SLOTS]; ///< position of the first set stored for every line, EMPTY_SLOT for none
+    int relation[LINE_SLOTS]; ///< position of the first relation stored for every line, EMPTY_SLOT for none
+    bool setHidden[LINE_SLOTS]; ///< the set of the line is hidden from operands
+    bool relationHidden[LINE_SLOTS]; ///< the relation of the line is hidden from operands
+    long setMax; ///< biggest line of the sets stored so far
+    long relationMax; ///< biggest line of the relations stored so far
+} lineTable_t;
+
+/// struct to store a single instruction of a compiled program, one per line of the file
+typedef struct
+{
+    int op; ///< the function of the command, OP_PRINT_SET or OP_PRINT_RELATION for definition lines, OP_INVALID
+    int command; ///< position of the command in the command list, EMPTY_SLOT for definition lines
+    int argc; ///< number of operands resolved before the command runs, select resolves its operand itself
+    int operand[MAX_OPERANDS]; ///< position of every operand in its list, EMPTY_SLOT when it names a command line
+    int operandLine[MAX_OPERANDS]; ///< line every operand names
+    int jump; ///< instruction to continue with when the command answers false, EMPTY_SLOT without a jump
+    bool lazy; ///< the result is printed but not stored, no operand names the line and it runs at most once
+} instruction_t;
+
+/// struct to store a compiled program
+typedef struct
+{
+    instruction_t *code; ///< one instruction per line of the file
+    int len; ///< number of instructions
+    int start; ///< instruction of the first command
+} program_t;
+
+/// a command run before, keyed by its function and the item sequences of its operands, with what it printed
+typedef struct
+{
+    uint64_t hash; ///< hash of the key
+    int op; ///< the function of the command, EMPTY_SLOT for a free slot
+    const void *operand[MAX_OPERANDS]; ///< the items of every operand, identical operands share them
+    int operandLen[MAX_OPERANDS]; ///< number of items of every operand
+    bool answer; ///< the answer of the command
+    int result; ///< position of the stored result in its list, EMPTY_SLOT for a predicate
+    bool relation; ///< the result is a relation
+    char *text; ///< the printed output of the command, NULL when the result is printed again instead
+    size_t textLen; ///< length of the printed output
+} memoEntry_t;
+
+/// open addressing table of the commands run before, so an identical command prints the same output again
+typedef struct
+{
+    memoEntry_t *entries; ///< the slots of the table
+    int size; ///< number of slots, always a power of two
+    int count; ///< number of used slots
+} memoTable_t;
+
 /// struct containing all commands in the file
 typedef struct
 {
     command_t *commands; ///< array of commands
     int commandList_len; ///< count of all commands
+    int commandList_cap; ///< number of commands the array has room for
 }commandList_t;
 
+/// a set, relation or command line parsed on its own, merged into the lists later in the order of the lines
+typedef struct
+{
+    set_t set; ///< the set of an S line
+    relation_t relation; ///< the relation of an R line
+    command_t command; ///< the command of a C line
+    commandList_t commands; ///< list holding only the command of a C line, empty when the line defines none
+    int status; ///< the status the reader of the line returned
+    char *message; ///< the error message of the line, NULL when there is none or it was already printed
+} parsedLine_t;
+
+/// buffered writer all results are printed through
+typedef struct
+{
+    char *buf; ///< buffer of OUTPUT_BUFFER_SIZE bytes
+    size_t len; ///< number of bytes waiting in the buffer
+    size_t flushed; ///< number of bytes handed to the stream so far
+    FILE *file; ///< unbuffered stream the buffer is flushed to
+} output_t;
+
+/// header of a compiled input, the sections follow it and are referred to by their offsets from the start of the file
+typedef struct
+{
+    char magic[8]; ///< SETC_MAGIC, distinguishes a compiled input from a text one
+    uint32_t version; ///< SETC_VERSION of the layout
+    uint32_t byteOrder; ///< SETC_BYTE_ORDER as stored by the compiling machine
+    uint16_t pointerSize; ///< size of a pointer of the compiling build
+    uint16_t setSize; ///< size of set_t of the compiling build
+    uint16_t relationSize; ///< size of relation_t of the compiling build
+    uint16_t commandSize; ///< size of command_t of the compiling build
+    int32_t initSize; ///< number of lines that are not command definitions
+    int32_t fileSize; ///< number of lines of the source file
+    int32_t universe_len; ///< number of universe items
+    int32_t pool_len; ///< number of bytes in the string pool
+    int32_t table_size; ///< number of slots of the universe hash table
+    int32_t setList_len; ///< number of sets
+    int32_t relationList_len; ///< number of relations
+    int32_t commandList_len; ///< number of commands
+    uint64_t pool; ///< offset of the string pool
+    uint64_t offsets; ///< offset of the offsets of the universe items
+    uint64_t lengths; ///< offset of the lengths of the universe items
+    uint64_t hashes; ///< offset of the hashes of the universe items
+    uint64_t table; ///< offset of the universe hash table
+    uint64_t sets; ///< offset of the set records, their items pointers hold offsets
+    uint64_t relations; ///< offset of the relation records, their items pointers hold offsets
+    uint64_t commands; ///< offset of the command records, their parameters pointers hold offsets
+    uint64_t size; ///< size of the whole file
+} setcHeader_t;
+
+/// a slot of the hash set of relation pairs
+typedef struct
+{
+    uint64_t key; ///< the pair packed into a single number
+    unsigned generation; ///< the line the key belongs to, slots of older lines count as free
+} pairSlot_t;
 
-/// Prints error messages to stderr
+/// scratch memory of the parser, allocated once and reused for every line
+typedef struct
+{
+    uint64_t *seen; ///< bitmap over universe indices marking the items of the set being read
+    pairSlot_t *pairs; ///< open addressing hash set of the pairs of the relation being read
+    int pairs_size; ///< number of slots in the hash set, always a power of two
+    int pairs_count; ///< number of pairs of the current line in the hash set
+    unsigned generation; ///< generation of the current line
+} parseScratch_t;
+
+/// the arena all objects of the program are allocated from
+arena_t arena = {.blocks = NULL, .current = NULL, .last = NULL, .allocations = 0, .blockCount = 0, .used = 0, .peak = 0};
+
+/// the representation the set operators look the items up in, chosen by the -b option
+int setBackend = BACKEND_BITMAP;
+
+/// results nothing reads are only printed and not stored, chosen by the -e option
+bool lazyEvaluation = false;
+
+#ifdef THREADED_EXECUTE
+/// number of threads the commands of a program without jumps run on, chosen by the -j option
+int threadCount = 1;
+/// the arena of a worker thread, the other threads allocate from the global arena
+pthread_key_t arenaKey;
+/// where a thread parsing lines keeps the error message of its line, the other threads print their messages
+pthread_key_t messageKey;
+#endif
+
+#ifdef SETCAL_STATS
+/// number of stored sets sharing the items of an identical set
+size_t internedSets;
+/// number of stored relations sharing the items of an identical relation
+size_t internedRelations;
+/// number of set comparisons decided by the fingerprints alone
+size_t fingerprintDecided;
+/// number of set comparisons that had to look at the items
+size_t fingerprintExact;
+/// number of commands whose output was taken from the memo table
+size_t memoHits;
+/// number of commands that ran because the memo table did not know them
+size_t memoMisses;
+/// number of adaptive containers built, by their kind
+size_t containerCount[CONTAINER_KINDS];
+/// number of bytes taken by the adaptive containers, by their kind
+size_t containerBytes[CONTAINER_KINDS];
+#endif
+
+
+/// Prints error messages to stderr, a thread parsing lines keeps the first message of its line instead
 /// \param msg a string to be printed to stderr
 /// \param status an integer to be returned by the function
 /// \return a status variable
 int errMsg(char *msg, int status)
 {
+#ifdef THREADED_EXECUTE
+    char **message = pthread_getspecific(messageKey);
+    if (message != NULL)
+    {
+        if (*message == NULL) *message = msg;
+        return status;
+    }
+#endif
     fprintf(stderr, "%s", msg);
     return status;
 }
 
-/// Safer and overall better realloc
+/// Rounds a size up to the alignment of the arena allocations
+/// \param size the size to be rounded
+/// \return the rounded size
+size_t arenaAlign(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+/// Returns the first usable byte of an arena block
+/// \param block the block
+/// \return pointer to the memory following the block header
+char *blockData(arenaBlock_t *block)
+{
+    return (char *) block + arenaAlign(sizeof(arenaBlock_t));
+}
+
+/// Allocates memory from the arena, every allocation is preceded by a header holding its size
+/// \param arena the arena to allocate from
+/// \param size number of bytes to be allocated
+/// \return NULL on failure, pointer to the new memory on success
+void *arenaAlloc(arena_t *arena, size_t size)
+{
+    size_t need = ARENA_ALIGN + arenaAlign(size);
+    arenaBlock_t *block = arena->current;
+
+    // reuse the blocks kept by arenaReset before asking the system for a new one
+    while (block != NULL && block->size - block->used < need)
+    {
+        block = block->next;
+    }
+
+    if (block == NULL)
+    {
+        size_t blockSize = need > ARENA_BLOCK_SIZE ? need : ARENA_BLOCK_SIZE;
+        block = malloc(arenaAlign(sizeof(arenaBlock_t)) + blockSize);
+        if (block == NULL) return NULL;
+
+        block->size = blockSize;
+        block->used = 0;
+
+        // link the new block right after the current one
+        if (arena->current == NULL)
+        {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+        else
+        {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        }
+        arena->blockCount++;
+    }
+
+    char *ptr = blockData(block) + block->used + ARENA_ALIGN;
+    *(size_t *) (ptr - ARENA_ALIGN) = arenaAlign(size);
+    block->used += need;
+
+    arena->current = block;
+    arena->last = ptr;
+    arena->allocations++;
+    arena->used += need;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+
+    return ptr;
+}
+
+/// Resizes an allocation made from the arena, the most recent allocation is grown in place when possible
+/// \param arena the arena the allocation belongs to
+/// \param ptr the allocation to be resized, NULL for a new allocation
+/// \param size the new size of the allocation
+/// \return NULL on failure, pointer to the resized memory on success
+void *arenaRealloc(arena_t *arena, void *ptr, size_t size)
+{
+    if (ptr == NULL) return arenaAlloc(arena, size);
+
+    size_t *oldSize = (size_t *) ((char *) ptr - ARENA_ALIGN);
+    if (size <= *oldSize) return ptr;
+
+    size_t grow = arenaAlign(size) - *oldSize;
+    if (ptr == arena->last && arena->current->size - arena->current->used >= grow)
+    {
+        arena->current->used += grow;
+        arena->used += grow;
+        if (arena->used > arena->peak) arena->peak = arena->used;
+        *oldSize += grow;
+        return ptr;
+    }
+
+    void *tmp = arenaAlloc(arena, size);
+    if (tmp != NULL) memcpy(tmp, ptr, *oldSize);
+    return tmp;
+}
+
+/// Gives the most recent allocation back to the arena, any other allocation is kept until the arena is reset
+/// \param arena the arena the allocation belongs to
+/// \param ptr the allocation to be released
+void arenaFree(arena_t *arena, void *ptr)
+{
+    if (ptr == NULL || ptr != arena->last) return;
+
+    size_t need = ARENA_ALIGN + *(size_t *) ((char *) ptr - ARENA_ALIGN);
+    arena->current->used -= need;
+    arena->used -= need;
+    arena->last = NULL;
+}
+
+/// Makes all memory of the arena available again while keeping its blocks for the next input
+/// \param arena the arena to be reset
+void arenaReset(arena_t *arena)
+{
+    for (arenaBlock_t *block = arena->blocks; block != NULL; block = block->next)
+    {
+        block->used = 0;
+    }
+    arena->current = arena->blocks;
+    arena->last = NULL;
+    arena->used = 0;
+}
+
+/// Remembers the position of an arena
+/// \param arena the arena
+/// \return the current position of the arena
+arenaMark_t arenaMark(arena_t *arena)
+{
+    arenaMark_t mark = {.block = arena->current, .blockUsed = 0, .used = arena->used};
+    if (arena->current != NULL) mark.blockUsed = arena->current->used;
+    return mark;
+}
+
+/// Releases everything allocated from an arena since a mark was taken, the blocks stay with the arena
+/// \param arena the arena
+/// \param mark the position taken by arenaMark
+void arenaRollback(arena_t *arena, arenaMark_t *mark)
+{
+    // the blocks after the current one are never handed out from, so those up to the current one were filled after the mark
+    if (arena->current != mark->block)
+    {
+        arenaBlock_t *block = mark->block != NULL ? mark->block->next : arena->blocks;
+        for (; block != NULL; block = block->next)
+        {
+            block->used = 0;
+            if (block == arena->current) break;
+        }
+    }
+    if (mark->block != NULL) mark->block->used = mark->blockUsed;
+
+    arena->current = mark->block != NULL ? mark->block : arena->blocks;
+    arena->last = NULL;
+    arena->used = mark->used;
+}
+
+/// Releases everything allocated from an arena since a mark was taken except one allocation, which is moved
+/// down to the mark
+/// \param arena the arena
+/// \param mark the position taken by arenaMark
+/// \param ptr an allocation made after the mark
+/// \param size number of bytes of the allocation to be kept
+/// \return NULL on failure or when the size is zero, pointer to the kept memory on success
+void *arenaKeep(arena_t *arena, arenaMark_t *mark, void *ptr, size_t size)
+{
+    arenaRollback(arena, mark);
+    if (ptr == NULL || size == 0) return NULL;
+
+    // the blocks are filled again from the mark on, so the new place never lies past the old one
+    void *kept = arenaAlloc(arena, size);
+    if (kept != NULL) memmove(kept, ptr, size);
+    return kept;
+}
+
+/// Hands all blocks of an arena over to another one, the allocations made from them stay valid until it is reset
+/// \param arena the arena taking the blocks
+/// \param other the arena giving its blocks away, it is left empty
+void arenaAdopt(arena_t *arena, arena_t *other)
+{
+    if (other->blocks == NULL) return;
+
+    // the blocks go in front of the current one, they are allocated from again only after a reset
+    arenaBlock_t *tail = other->blocks;
+    while (tail->next != NULL) tail = tail->next;
+    tail->next = arena->blocks;
+    arena->blocks = other->blocks;
+    if (arena->current == NULL) arena->current = tail;
+
+    arena->allocations += other->allocations;
+    arena->blockCount += other->blockCount;
+    arena->used += other->used;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    other->blocks = NULL;
+    other->current = NULL;
+    other->last = NULL;
+    other->used = 0;
+}
+
+/// Returns all blocks of the arena to the system
+/// \param arena the arena to be released
+void arenaRelease(arena_t *arena)
+{
+    while (arena->blocks != NULL)
+    {
+        arenaBlock_t *next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+    arena->current = NULL;
+    arena->last = NULL;
+    arena->used = 0;
+}
+
+/// Finds the arena the calling thread allocates from
+/// \return the arena of a worker thread, the global arena for any other thread
+arena_t *ownArena(void)
+{
+#ifdef THREADED_EXECUTE
+    arena_t *own = pthread_getspecific(arenaKey);
+    if (own != NULL) return own;
+#endif
+    return &arena;
+}
+
+/// Safer and overall better realloc, the memory is owned by the arena and released all at once
 /// \param ptr a dynamically allocated array
 /// \param size indicates the size of the dynamic array after reallocation
-/// \return NULL on failure, pointer to the new memory on success
+/// \return NULL on failure or when the size is zero, pointer to the new memory on success
 void *bigBrainRealloc(void *ptr, size_t size)
 {
-    if (size <= 0)
+    if (size <= 0) return NULL;
+
+    return arenaRealloc(ownArena(), ptr, size);
+}
+
+/// Makes room for at least count items in a dynamic array, the capacity is doubled so appending is amortized O(1)
+/// \param items the dynamic array, NULL when nothing has been allocated yet
+/// \param capacity number of items the array has room for, updated on growth
+/// \param count number of items the array has to hold
+/// \param itemSize size of a single item
+/// \return NULL on failure, pointer to the array on success
+void *growArray(void *items, int *capacity, int count, size_t itemSize)
+{
+    if (count <= *capacity && items != NULL) return items;
+
+    int newCapacity = *capacity > 0 ? *capacity : INIT_ARRAY_CAPACITY;
+    while (newCapacity < count)
     {
-        if (ptr != NULL) free(ptr);
-        return NULL;
+        newCapacity *= 2;
     }
 
-    void *tmp = realloc(ptr, size);
-    if (tmp == NULL)
+    items = bigBrainRealloc(items, newCapacity * itemSize);
+    if (items != NULL) *capacity = newCapacity;
+    return items;
+}
+
+/// Reads the entire file into memory using large block reads
+/// \param file the file to be read
+/// \param input the input buffer where the contents of the file are stored
+/// \return false on failure of an allocation or a read error, true on success
+int readInput(FILE *file, input_t *input)
+{
+    long capacity = INPUT_BLOCK_SIZE;
+    input->data = NULL;
+    input->len = 0;
+    input->pos = 0;
+
+    while (true)
     {
-        if (ptr != NULL) free(ptr);
-        return NULL;
+        input->data = bigBrainRealloc(input->data, capacity);
+        if (input->data == NULL)
+            return errMsg("Allocation failed.\n", false);
+
+        // keep one byte free for the terminating '\0'
+        input->len += fread(input->data + input->len, 1, capacity - input->len - 1, file);
+        if (input->len < capacity - 1) break;
+
+        capacity *= 2;
     }
 
-    else
-        return tmp;
+    if (ferror(file))
+        return errMsg("Error reading file.\n", false);
+
+    input->data[input->len] = '\0';
+    return true;
 }
 
 /// Checks for space between U, R, S and it's contents
-/// \param file the file to be read from
+/// \param input the input buffer to be read from
 /// \return DELIM when a space is present
-/// \return true when a newline is present (special condition for empty sets, ...)
+/// \return true when a newline or the end of the input is present (special condition for empty sets, ...)
 /// \return false when no space or newline is present
-int testSpace(FILE *file)
+int testSpace(input_t *input)
 {
-    char c;
-    fscanf(file, "%c", &c);
+    if (input->pos >= input->len) return true;
+
+    char c = input->data[input->pos++];
     if (c == '\n') return true;
     else if (c != DELIM) return errMsg("No space between identifier and it's definition.\n", false);
     else return DELIM;
 }
 
 
-/// Function for reading strings seperated by whitespace from the specified file
-/// \param file the file to be read from
-/// \param string container for the new string
+/// Function for reading strings seperated by whitespace from the input buffer, the string is not copied
+/// \param input the input buffer to be read from
+/// \param token container for the new string, pointing into the input buffer
 /// \return false when an error occurs during reading
 /// \return true when a string is successfully read
 /// \return END_OF_LINE when a newline or EOF is reached at the end of the string
-int readStringFromFile(FILE *file, char **string)
+int readToken(input_t *input, token_t *token)
 {
-    char c;
-    int strLen = 0;
+    const char *ptr = input->data + input->pos;
+    const char *end = input->data + input->len;
 
-    // allocate memory for the string
-    *string = malloc((MAX_STR_LEN + 1) * sizeof(char));
-    if (*string == NULL)
-        return errMsg("Allocation failed.\n", false);
+    // skip the whitespace in front of the string
+    while (ptr < end && *ptr == DELIM) ptr++;
+
+    // find the end of the string
+    token->str = ptr;
+    while (ptr < end && *ptr != DELIM && *ptr != '\n') ptr++;
+
+    // check if the maximum length wasn't reached
+    if (ptr - token->str > MAX_STR_LEN)
+        return errMsg("Items cannot be more than 30 characters long.\n", false);
+
+    token->len = ptr - token->str;
+
+    // consume the character terminating the string
+    input->pos = ptr - input->data;
+    if (ptr == end) return END_OF_LINE;
+
+    input->pos++;
+    return *ptr == '\n' ? END_OF_LINE : true;
+}
+
+/// Scrambles the bits of a packed relation pair or of a set item (splitmix64 finalizer)
+/// \param key the packed pair or the item
+/// \return the hash of the pair
+uint64_t hashPair(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9u;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebu;
+    key ^= key >> 31;
+    return key;
+}
 
-    *string[0] = '\0';
+/// Computes the fingerprint of a set from its items
+/// \param set the set whose fingerprint is computed
+void fingerprintSet(set_t *set)
+{
+    set->min = set->max = -1;
+    set->hash = set->signature = 0;
 
-    // read the string, character by character
-    while (fscanf(file, "%c", &c) != EOF)
+    for (int i = 0; i < set->set_len; i++)
     {
-        if (c == '\n') return END_OF_LINE;
-        else if (c == DELIM && strLen != 0) return true;
+        uint64_t mixed = hashPair(set->items[i]);
+        if (set->min == -1 || set->items[i] < set->min) set->min = set->items[i];
+        if (set->items[i] > set->max) set->max = set->items[i];
+        set->hash += mixed;
+        set->signature |= (uint64_t) 1 << (mixed >> 58);
+    }
+}
 
-            // the start condition is met and all whitespace is gone -> start adding characters to the string
-        else if (c != DELIM)
-        {
-            // check if the maximum length wasn't reached
-            if (++strLen > MAX_STR_LEN)
-            {
-                free(*string);
-                return errMsg("Items cannot be more than 30 characters long.\n", false);
-            }
+/// Makes room in an intern table so that it stays at most half full, the slots are rehashed by their stored hashes
+/// \param table the table
+/// \return false on failure of an allocation, true on success
+int growIntern(internTable_t *table)
+{
+    if (table->slots != NULL && 2 * (table->count + 1) <= table->size) return true;
 
-            (*string)[strLen - 1] = c;
-            (*string)[strLen] = '\0';
+    int size = table->slots == NULL ? INIT_TABLE_SIZE : 2 * table->size;
+    internSlot_t *slots = bigBrainRealloc(NULL, size * sizeof(internSlot_t));
+    if (slots == NULL) return errMsg("Allocation failed.\n", false);
 
-        }
+    for (int i = 0; i < size; i++)
+    {
+        slots[i].idx = EMPTY_SLOT;
+    }
+    for (int i = 0; i < table->size; i++)
+    {
+        if (table->slots[i].idx == EMPTY_SLOT) continue;
+
+        unsigned slot = table->slots[i].hash & (size - 1);
+        while (slots[slot].idx != EMPTY_SLOT) slot = (slot + 1) & (size - 1);
+        slots[slot] = table->slots[i];
+    }
+
+    table->slots = slots;
+    table->size = size;
+    return true;
+}
+
+/// Makes the last set of the list share the items and the cached representations of an identical stored set, \n
+/// a set with a new item sequence becomes the owner of the sequence
+/// \param sets list of all sets
+/// \return false on failure of an allocation, true on success
+int internSet(setList_t *sets)
+{
+    set_t *set = &sets->sets[sets->setList_len - 1];
+    if (!growIntern(&sets->intern)) return false;
+
+    uint64_t hash = set->set_len;
+    for (int i = 0; i < set->set_len; i++)
+    {
+        hash = hashPair(hash ^ (uint64_t) set->items[i]);
+    }
+
+    internSlot_t *slots = sets->intern.slots;
+    unsigned slot = hash & (sets->intern.size - 1);
+    for (; slots[slot].idx != EMPTY_SLOT; slot = (slot + 1) & (sets->intern.size - 1))
+    {
+        set_t *owner = &sets->sets[slots[slot].idx];
+        if (slots[slot].hash != hash || owner->set_len != set->set_len ||
+            (set->set_len != 0 && memcmp(owner->items, set->items, set->set_len * sizeof(int)) != 0)) continue;
+
+        // a freshly computed result is usually the last allocation, so its copy of the items is released
+        if (set->items != owner->items) arenaFree(&arena, set->items);
+        set->items = owner->items;
+        if (set->bits == NULL) set->bits = owner->bits;
+        if (set->sorted == NULL) set->sorted = owner->sorted;
+        if (set->chunks == NULL) set->chunks = owner->chunks;
+#ifdef SETCAL_STATS
+        internedSets++;
+#endif
+        return true;
+    }
+
+    slots[slot].hash = hash;
+    slots[slot].idx = sets->setList_len - 1;
+    sets->intern.count++;
+    return true;
+}
+
+/// Makes the last relation of the list share the items of an identical stored relation, \n
+/// a relation with a new item sequence becomes the owner of the sequence
+/// \param relations list of all relations
+/// \return false on failure of an allocation, true on success
+int internRelation(relationList_t *relations)
+{
+    relation_t *relation = &relations->relations[relations->relationList_len - 1];
+    if (!growIntern(&relations->intern)) return false;
+
+    uint64_t hash = relation->relation_len;
+    for (int i = 0; i < relation->relation_len; i++)
+    {
+        hash = hashPair(hash ^ ((uint64_t) relation->items[i].x << 32 | (uint32_t) relation->items[i].y));
+    }
+
+    internSlot_t *slots = relations->intern.slots;
+    unsigned slot = hash & (relations->intern.size - 1);
+    for (; slots[slot].idx != EMPTY_SLOT; slot = (slot + 1) & (relations->intern.size - 1))
+    {
+        relation_t *owner = &relations->relations[slots[slot].idx];
+        if (slots[slot].hash != hash || owner->relation_len != relation->relation_len ||
+            (relation->relation_len != 0 &&
+             memcmp(owner->items, relation->items, relation->relation_len * sizeof(relationUnit_t)) != 0)) continue;
+
+        if (relation->items != owner->items) arenaFree(&arena, relation->items);
+        relation->items = owner->items;
+        if (relation->csr == NULL) relation->csr = owner->csr;
+#ifdef SETCAL_STATS
+        internedRelations++;
+#endif
+        return true;
     }
-    return END_OF_LINE;
+
+    slots[slot].hash = hash;
+    slots[slot].idx = relations->relationList_len - 1;
+    relations->intern.count++;
+    return true;
 }
 
 /// Saves a set into the setList
@@ -208,7 +948,7 @@ int readStringFromFile(FILE *file, char **string)
 /// \return false on failure of an allocation, true on success
 int insertToSetList(set_t *set, setList_t *sets)
 {
-    sets->sets = bigBrainRealloc(sets->sets, ++sets->setList_len * sizeof(set_t));
+    sets->sets = growArray(sets->sets, &sets->setList_cap, ++sets->setList_len, sizeof(set_t));
 
     // check for memory error
     if (sets->sets == NULL)
@@ -218,8 +958,12 @@ int insertToSetList(set_t *set, setList_t *sets)
 
     sets->sets[sets->setList_len - 1].set_len = set->set_len;
     sets->sets[sets->setList_len - 1].items = set->items;
+    sets->sets[sets->setList_len - 1].bits = set->bits;
+    sets->sets[sets->setList_len - 1].sorted = set->sorted;
+    sets->sets[sets->setList_len - 1].chunks = set->chunks;
     sets->sets[sets->setList_len - 1].index = set->index;
-    return true;
+    fingerprintSet(&sets->sets[sets->setList_len - 1]);
+    return internSet(sets);
 }
 
 /// Saves a relation into the relationList
@@ -228,7 +972,7 @@ int insertToSetList(set_t *set, setList_t *sets)
 /// \return false on failure of an allocation, true on success
 int insertToRelatioList(relation_t *relation, relationList_t *relations)
 {
-    relations->relations = bigBrainRealloc(relations->relations, ++relations->relationList_len * sizeof(relation_t));
+    relations->relations = growArray(relations->relations, &relations->relationList_cap, ++relations->relationList_len, sizeof(relation_t));
 
     // check for memory errors
     if (relations->relations == NULL)
@@ -238,7 +982,8 @@ int insertToRelatioList(relation_t *relation, relationList_t *relations)
 
     relations->relations[relations->relationList_len - 1].relation_len = relation->relation_len;
     relations->relations[relations->relationList_len - 1].items = relation->items;
-    return true;
+    relations->relations[relations->relationList_len - 1].csr = relation->csr;
+    return internRelation(relations);
 }
 
 /// Saves a command into the commandList
@@ -248,7 +993,7 @@ int insertToRelatioList(relation_t *relation, relationList_t *relations)
 /// \return false on failure of an allocation, true on success
 int insertIntoCommandList(commandList_t *commands, command_t *command, int lineIndex)
 {
-    commands->commands = bigBrainRealloc(commands->commands, ++commands->commandList_len * sizeof(command_t));
+    commands->commands = growArray(commands->commands, &commands->commandList_cap, ++commands->commandList_len, sizeof(command_t));
     if (commands->commands == NULL) return false;
 
     commands->commands[commands->commandList_len - 1].functionNameIdx = command->functionNameIdx;
@@ -260,191 +1005,270 @@ int insertIntoCommandList(commandList_t *commands, command_t *command, int lineI
     return true;
 }
 
-/// Decides whether a string is a valid universe item or not
-/// \param str new universe item to be validated
-/// \param universe list of already existing universe items
-/// \return true when the item meets all criteria (no duplicates, only alphabetical characters, no function names, true, false)
-/// \return false when at least one criterium is not fulfilled
-int checkUniverse(char *str, universe_t *universe)
+/// Computes a hash of a string (FNV-1a)
+/// \param str the string to be hashed
+/// \param len length of the string
+/// \return the hash of the string
+unsigned hashString(const char *str, int len)
 {
-    for (int i = 0, n = strlen(str); i < n; i++)
+    unsigned hash = 2166136261u;
+    for (int i = 0; i < len; i++)
     {
-        if (!isalpha(str[i])) return false;
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
     }
+    return hash;
+}
 
-    if (strcmp(str, "false") == 0 || strcmp(str, "true") == 0) return false;
-
-    for (int i = 0; i < COMBINED_FUNCTIONS_LASTINDEX; i++)
-    {
-        if (strcmp(str, functions[i]) == 0) return false;
-    }
+/// Returns the name of a universe item
+/// \param universe the universe containing the item
+/// \param idx index of the item in the universe
+/// \return the '\0' terminated name of the item stored in the string pool
+char *universeItem(universe_t *universe, int idx)
+{
+    return universe->pool + universe->offsets[idx];
+}
 
-    for (int i = 0; i < universe->universe_len - 1; i++)
+/// Places an index of a universe item into the first free slot of the hash table
+/// \param table the hash table
+/// \param size number of slots in the table, a power of two
+/// \param hash precomputed hash of the item
+/// \param idx index of the item in the universe
+void placeIntoTable(int *table, int size, unsigned hash, int idx)
+{
+    unsigned slot = hash & (size - 1);
+    while (table[slot] != EMPTY_SLOT)
     {
-        if (strcmp(universe->items[i], str) == 0) return false;
+        slot = (slot + 1) & (size - 1);
     }
-
-    return true;
+    table[slot] = idx;
 }
 
-/// Reads and validates the universe contents
-/// \param universe a universe struct where the contents are saved
-/// \param file the file to be read from
-/// \return true when no error occurs during reading, false otherwise
-/// \return EMPTY_INDEX when trailing whitespace is present
-int readUniverse(universe_t *universe, FILE *file)
+/// Adds the last universe item into the hash index of the universe, the table is doubled when it is half full
+/// \param universe the universe whose last item is being indexed
+/// \return false on failure of an allocation, true on success
+int indexUniverseItem(universe_t *universe)
 {
-    char *str;
-    int c, status;
-    if ((c = testSpace(file)) != DELIM) return c;
+    int idx = universe->universe_len - 1;
 
-    do
-    {
-        // try reading a string from the specified file
-        status = readStringFromFile(file, &str);
+    universe->hashes[idx] = hashString(universeItem(universe, idx), universe->lengths[idx]);
 
-        // an error occurred while reading the file
-        if (!status) return false;
+    if (universe->table == NULL || 2 * universe->universe_len > universe->table_size)
+    {
+        int size = universe->table == NULL ? INIT_TABLE_SIZE : 2 * universe->table_size;
+        int *table = bigBrainRealloc(NULL, size * sizeof(int));
+        if (table == NULL)
+            return errMsg("Allocation failed.\n", false);
 
-        // get rid of trailing whitespace
-        if (status == END_OF_LINE && strlen(str) == 0)
+        for (int i = 0; i < size; i++)
         {
-            free(str);
-            return EMPTY_INDEX;
+            table[i] = EMPTY_SLOT;
         }
 
-        universe->items = bigBrainRealloc(universe->items, ++universe->universe_len * sizeof(char *));
-
-        // check for memory errors
-        if (universe->items == NULL)
+        // rehash the already indexed items using their stored hashes
+        for (int i = 0; i < idx; i++)
         {
-            free(str);
-            return errMsg("Reallocation failed.\n", false);
+            placeIntoTable(table, size, universe->hashes[i], i);
         }
 
-        universe->items[universe->universe_len - 1] = str;
-
-        // validate the newly added item
-        if (!checkUniverse(universe->items[universe->universe_len - 1], universe))
-        {
-            return errMsg("Duplicity in universe\n", false);
-        }
-    } while (status != END_OF_LINE);
+        universe->table = table;
+        universe->table_size = size;
+    }
 
-    // if the loop finishes, we have successfully read the universe
+    placeIntoTable(universe->table, universe->table_size, universe->hashes[idx], idx);
     return true;
 }
 
-/// Reads universe and append it in set structure to the setList, so it can be used in the same way as a regular set
-/// \param universe the universe
-/// \param sets structure containing all sets in the file
-/// \param file the file to be read from
-/// \return true when no error occurs during reading, false otherwise
-int appendUniverse(universe_t *universe, setList_t *sets, FILE *file)
+/// Finds the index of the specified string from the universe
+/// \param str the string whose index we are looking for
+/// \param len length of the string
+/// \param universe the universe in which we are looking for the index
+/// \return the index of the wanted item from the universe, otherwise INVALID_INDEX
+int findUniverseIndex(const char *str, int len, universe_t *universe)
 {
-    int status = readUniverse(universe, file);
+    if (universe->table == NULL) return INVALID_INDEX;
 
-    if (status)
+    unsigned hash = hashString(str, len);
+    unsigned slot = hash & (universe->table_size - 1);
+
+    // walk the probe sequence until a free slot is hit
+    while (universe->table[slot] != EMPTY_SLOT)
     {
-        set_t set = {.set_len = universe->universe_len, .items = NULL};
+        int i = universe->table[slot];
+        if (universe->hashes[i] == hash && universe->lengths[i] == len && memcmp(str, universeItem(universe, i), len) == 0)
+        {
+            return i;
+        }
+        slot = (slot + 1) & (universe->table_size - 1);
+    }
 
-        if (status == EMPTY_INDEX && insertToSetList(&set, sets)) return true;
+    // the item wasn't found in the universe, so it's an invalid item
+    return INVALID_INDEX;
+}
 
-        set.items = bigBrainRealloc(set.items, sizeof(int) * set.set_len);
-        if (set.items == NULL && set.set_len != 0) return errMsg("Allocation failed\n", false);
+/// Looks up a reserved word using its perfect hash
+/// \param str the string to be looked up
+/// \param len length of the string
+/// \return the matching keyword, NULL when the string is not a reserved word
+const keyword_t *findKeyword(const char *str, int len)
+{
+    if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN) return NULL;
 
-        for (int i = 0; i < set.set_len; i++)
-        {
-            set.items[i] = i;
-        }
+    const keyword_t *keyword = &keywords[KEYWORD_SLOT((unsigned char) str[0], (unsigned char) str[len - 2],
+                                                      (unsigned char) str[len - 1], len)];
 
-        if (insertToSetList(&set, sets)) return true;
-        else
-        {
-            free(set.items);
-            return false;
-        }
+    if (keyword->word == NULL || (int) strlen(keyword->word) != len || memcmp(keyword->word, str, len) != 0)
+        return NULL;
+
+    return keyword;
+}
+
+/// Decides whether a string is a valid universe item or not
+/// \param str new universe item to be validated
+/// \param universe list of already existing universe items
+/// \return true when the item meets all criteria (no duplicates, only alphabetical characters, no function names, true, false)
+/// \return false when at least one criterium is not fulfilled
+int checkUniverse(char *str, universe_t *universe)
+{
+    int len = strlen(str);
+    for (int i = 0; i < len; i++)
+    {
+        if (!isalpha(str[i])) return false;
     }
-    else return false;
+
+    if (findKeyword(str, len) != NULL) return false;
+
+    // the new item is not indexed yet, so it can only be found if it is a duplicate
+    if (findUniverseIndex(str, len, universe) != INVALID_INDEX) return false;
+
+    return true;
 }
 
-/// Finds the index of the specified string from the universe
-/// \param str the string whose index we are looking for
-/// \param universe the universe in which we are looking for the index
-/// \return the index of the wanted item from the universe, otherwise INVALID_INDEX
-int findUniverseIndex(char *str, universe_t *universe)
+/// Reads and validates the universe contents
+/// \param universe a universe struct where the contents are saved
+/// \param input the input buffer to be read from
+/// \return true when no error occurs during reading, false otherwise
+/// \return EMPTY_INDEX when trailing whitespace is present
+int readUniverse(universe_t *universe, input_t *input)
 {
-    for (int i = 0; i < universe->universe_len; i++)
+    token_t token;
+    int c, status;
+    if ((c = testSpace(input)) != DELIM) return c;
+
+    do
     {
-        if (strcmp(str, universe->items[i]) == 0)
+        // try reading a string from the specified file
+        status = readToken(input, &token);
+
+        // an error occurred while reading the file
+        if (!status) return false;
+
+        // get rid of trailing whitespace
+        if (status == END_OF_LINE && token.len == 0)
         {
-            return i;
+            return EMPTY_INDEX;
         }
-    }
 
-    // the item wasn't found in the universe, so it's an invalid item
-    return INVALID_INDEX;
+        universe->universe_len++;
+
+        // the offsets, lengths and hashes always grow together
+        if (universe->universe_len > universe->universe_cap)
+        {
+            int capacity = universe->universe_cap;
+            universe->offsets = growArray(universe->offsets, &capacity, universe->universe_len, sizeof(int));
+            capacity = universe->universe_cap;
+            universe->lengths = growArray(universe->lengths, &capacity, universe->universe_len, sizeof(int));
+            universe->hashes = growArray(universe->hashes, &universe->universe_cap, universe->universe_len, sizeof(unsigned));
+        }
+        universe->pool = growArray(universe->pool, &universe->pool_cap, universe->pool_len + token.len + 1, sizeof(char));
+
+        // check for memory errors
+        if (universe->offsets == NULL || universe->lengths == NULL || universe->hashes == NULL || universe->pool == NULL)
+        {
+            return errMsg("Reallocation failed.\n", false);
+        }
+
+        // copy the item into the string pool
+        universe->offsets[universe->universe_len - 1] = universe->pool_len;
+        universe->lengths[universe->universe_len - 1] = token.len;
+        memcpy(universe->pool + universe->pool_len, token.str, token.len);
+        universe->pool_len += token.len + 1;
+        universe->pool[universe->pool_len - 1] = '\0';
+
+        // validate the newly added item
+        if (!checkUniverse(universeItem(universe, universe->universe_len - 1), universe))
+        {
+            return errMsg("Duplicity in universe\n", false);
+        }
+
+        if (!indexUniverseItem(universe)) return false;
+    } while (status != END_OF_LINE);
+
+    // if the loop finishes, we have successfully read the universe
+    return true;
 }
 
-/// Checks whether a relation contains the specified relation pair
-/// \param relation the relation in which we are searching
-/// \param unit the relation pair we are looking for in the relation
-/// \return the index of the wanted relation pair in the relation, otherwise INVALID_INDEX
-int containsRelationUnit(relation_t *relation, relationUnit_t *unit)
+/// Reads universe and append it in set structure to the setList, so it can be used in the same way as a regular set
+/// \param universe the universe
+/// \param sets structure containing all sets in the file
+/// \param input the input buffer to be read from
+/// \return true when no error occurs during reading, false otherwise
+int appendUniverse(universe_t *universe, setList_t *sets, input_t *input)
 {
-    for (int i = 0; i < relation->relation_len; i++)
+    int status = readUniverse(universe, input);
+
+    if (status)
     {
-        if (relation->items[i].x == unit->x && relation->items[i].y == unit->y)
+        set_t set = {.set_len = universe->universe_len, .items = NULL, .bits = NULL, .sorted = NULL, .chunks = NULL};
+
+        if (status == EMPTY_INDEX && insertToSetList(&set, sets)) return true;
+
+        set.items = bigBrainRealloc(set.items, sizeof(int) * set.set_len);
+        if (set.items == NULL && set.set_len != 0) return errMsg("Allocation failed\n", false);
+
+        for (int i = 0; i < set.set_len; i++)
         {
-            return i;
+            set.items[i] = i;
         }
+
+        return insertToSetList(&set, sets);
     }
-    return INVALID_INDEX;
+    else return false;
 }
 
 /// Parses a relation pair from the specified file
 /// \param unit container for the relation pair to be read
-/// \param file the file to be read from
+/// \param input the input buffer to be read from
 /// \param universe the universe the members of the pair have to be part of
 /// \return true if a relation pair is successfully read
 /// \return EMPTY_INDEX if a trailing whitespace is read
 /// \return END_OF_LINE if newline is the next character in the file after the relation pair
 /// \return false if an error happens during reading
-int readRelationUnit(relationUnit_t *unit, FILE *file, universe_t *universe)
+int readRelationUnit(relationUnit_t *unit, input_t *input, universe_t *universe)
 {
-    char *strX, *strY;
+    token_t tokX, tokY;
 
-    int statusX = readStringFromFile(file, &strX);
+    int statusX = readToken(input, &tokX);
     if (!statusX) return false;
 
     // trailing whitespace has been read
-    if (statusX == END_OF_LINE && strlen(strX) == 0)
+    if (statusX == END_OF_LINE && tokX.len == 0)
     {
-        free(strX);
         return EMPTY_INDEX;
     }
 
-    int statusY = readStringFromFile(file, &strY);
-    if (!statusY)
-    {
-        free(strX);
-        return false;
-    }
+    int statusY = readToken(input, &tokY);
+    if (!statusY) return false;
+
     // check if the pair is in valid format
-    if (strX[0] != '(' || strY[strlen(strY) - 1] != ')')
+    if (tokX.str[0] != '(' || tokY.len == 0 || tokY.str[tokY.len - 1] != ')')
     {
-        free(strX); free(strY);
         return errMsg("Invalid relation.\n", false);
     }
 
-    strY[strlen(strY) - 1] = '\0';
-
     // compare without opening and closing brace
-    int idx = findUniverseIndex(&strX[1], universe);
-    int idy = findUniverseIndex(strY, universe);
-
-    free(strX);
-    free(strY);
+    int idx = findUniverseIndex(tokX.str + 1, tokX.len - 1, universe);
+    int idy = findUniverseIndex(tokY.str, tokY.len - 1, universe);
 
     if (idx == INVALID_INDEX || idy == INVALID_INDEX)
         return errMsg("The relation contains items that are not part of the universe.\n", false);
@@ -455,47 +1279,103 @@ int readRelationUnit(relationUnit_t *unit, FILE *file, universe_t *universe)
     return statusY;
 }
 
+/// Places a packed pair into the hash set of the parser, the slots left by older lines are reused
+/// \param pairs the slots of the hash set
+/// \param size number of slots, a power of two
+/// \param key the packed pair
+/// \param generation generation of the current line
+/// \return true when the pair was added, false when it was already present
+int placePair(pairSlot_t *pairs, int size, uint64_t key, unsigned generation)
+{
+    uint64_t slot = hashPair(key) & (size - 1);
+    while (pairs[slot].generation == generation)
+    {
+        if (pairs[slot].key == key) return false;
+        slot = (slot + 1) & (size - 1);
+    }
+    pairs[slot].key = key;
+    pairs[slot].generation = generation;
+    return true;
+}
+
+/// Adds a relation pair to the hash set of the current line, the set is only reallocated when a line
+/// has more pairs than any line before
+/// \param scratch scratch memory of the parser
+/// \param unit the pair to be added
+/// \return true when the pair is new, false when it is a duplicate, INVALID_INDEX on failure of an allocation
+int insertPair(parseScratch_t *scratch, relationUnit_t *unit)
+{
+    if (2 * (scratch->pairs_count + 1) > scratch->pairs_size)
+    {
+        int size = scratch->pairs_size == 0 ? INIT_TABLE_SIZE : 2 * scratch->pairs_size;
+        pairSlot_t *pairs = bigBrainRealloc(NULL, size * sizeof(pairSlot_t));
+        if (pairs == NULL)
+            return errMsg("Allocation failed.\n", INVALID_INDEX);
+
+        // generation 0 is never used by a line, so all new slots are free
+        memset(pairs, 0, size * sizeof(pairSlot_t));
+        for (int i = 0; i < scratch->pairs_size; i++)
+        {
+            if (scratch->pairs[i].generation == scratch->generation)
+                placePair(pairs, size, scratch->pairs[i].key, scratch->generation);
+        }
+        scratch->pairs = pairs;
+        scratch->pairs_size = size;
+    }
+
+    uint64_t key = (uint64_t) unit->x << 32 | (uint32_t) unit->y;
+    if (!placePair(scratch->pairs, scratch->pairs_size, key, scratch->generation)) return false;
+
+    scratch->pairs_count++;
+    return true;
+}
+
 /// Parses an entire relation from the specified file
 /// \param relation container for the relation to be read
-/// \param file the file to be read from
+/// \param input the input buffer to be read from
 /// \param universe the universe the members of the relation have to be part of
+/// \param scratch scratch memory of the parser used for the duplicity check
 /// \return true if a relation is successfully read
 /// \return false if an error happens during reading
-int readRelation(relation_t *relation, FILE *file, universe_t *universe)
+int readRelation(relation_t *relation, input_t *input, universe_t *universe, parseScratch_t *scratch)
 {
     relation->relation_len = 0;
+    relation->csr = NULL;
     relation->items = NULL;
+    int capacity = 0;
+
+    // start a new generation, all pairs of the previous lines are forgotten
+    scratch->generation++;
+    scratch->pairs_count = 0;
 
     // test for opening space
     int c, status;
-    if ((c = testSpace(file)) != DELIM) return c;
+    if ((c = testSpace(input)) != DELIM) return c;
 
     // read relation pairs from the file until end of line
     do
     {
-        relation->items = bigBrainRealloc(relation->items, ++relation->relation_len * sizeof(relationUnit_t));
+        relation->items = growArray(relation->items, &capacity, relation->relation_len + 1, sizeof(relationUnit_t));
         if (relation->items == NULL)
         {
             return errMsg("Allocation failed.\n", false);
         }
 
-        status = readRelationUnit(&relation->items[relation->relation_len - 1], file, universe);
+        status = readRelationUnit(&relation->items[relation->relation_len], input, universe);
         if (!status)
         {
             return false;
         }
         else if (status == EMPTY_INDEX)
         {
-            relation->items = bigBrainRealloc(relation->items, --relation->relation_len * sizeof(relationUnit_t));
-            if (relation->items == NULL && relation->relation_len != 0)
-            {
-                return errMsg("Allocation failed.\n", false);
-            }
             break;
         }
+        relation->relation_len++;
 
         // check for duplicates in the current relation
-        if (containsRelationUnit(relation, &relation->items[relation->relation_len - 1]) != relation->relation_len - 1)
+        int isNew = insertPair(scratch, &relation->items[relation->relation_len - 1]);
+        if (isNew == INVALID_INDEX) return false;
+        else if (!isNew)
         {
             return errMsg("Duplicity in a relation\n", false);
         }
@@ -507,27 +1387,25 @@ int readRelation(relation_t *relation, FILE *file, universe_t *universe)
 
 /// Parses a set item from the specified file
 /// \param idx container for the set item to be read
-/// \param file the file to be read from
+/// \param input the input buffer to be read from
 /// \param universe the universe the set item has to be part of
 /// \return true if a set item is successfully read
 /// \return EMPTY_INDEX if a trailing whitespace is read
 /// \return END_OF_LINE if newline is the next character in the file after the set item
 /// \return false if an error happens during reading
-int readSetItem(int *idx, FILE *file, universe_t *universe)
+int readSetItem(int *idx, input_t *input, universe_t *universe)
 {
-    char *str;
-    int status = readStringFromFile(file, &str);
+    token_t token;
+    int status = readToken(input, &token);
     if (!status) return false;
 
     // trailing whitespace has been read
-    if (strlen(str) == 0 && status == END_OF_LINE)
+    if (token.len == 0 && status == END_OF_LINE)
     {
-        free(str);
         return EMPTY_INDEX;
     }
 
-    *idx = findUniverseIndex(str, universe);
-    free(str);
+    *idx = findUniverseIndex(token.str, token.len, universe);
 
     // check for validity of the item read
     if (*idx == INVALID_INDEX)
@@ -539,1650 +1417,3486 @@ int readSetItem(int *idx, FILE *file, universe_t *universe)
 
 /// Parses an entire set from the specified file
 /// \param set container for the set to be read
-/// \param file the file to be read from
+/// \param input the input buffer to be read from
 /// \param universe the universe the members of the set have to be part of
+/// \param scratch scratch memory of the parser used for the duplicity check
 /// \return true if a set is successfully read
 /// \return false if an error happens during reading
-int readSet(set_t *set, FILE *file, universe_t *universe)
+int readSet(set_t *set, input_t *input, universe_t *universe, parseScratch_t *scratch)
 {
     set->set_len = 0;
     set->items = NULL;
+    set->bits = NULL;
+    set->sorted = NULL;
+    set->chunks = NULL;
+    int capacity = 0;
+
+    // the bitmap is allocated once the universe is known and cleared after every line
+    if (scratch->seen == NULL && universe->universe_len != 0)
+    {
+        int words = (universe->universe_len + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        scratch->seen = bigBrainRealloc(NULL, words * sizeof(uint64_t));
+        if (scratch->seen == NULL)
+            return errMsg("Allocation failed.\n", false);
+        memset(scratch->seen, 0, words * sizeof(uint64_t));
+    }
 
     // test for opening space or empty set
     int c, status;
-    if ((c = testSpace(file)) != DELIM) return c;
+    if ((c = testSpace(input)) != DELIM) return c;
 
     // read set items until newline is reached
     do
     {
-        set->items = bigBrainRealloc(set->items, ++set->set_len * sizeof(int));
+        set->items = growArray(set->items, &capacity, set->set_len + 1, sizeof(int));
         if (set->items == NULL)
             return errMsg("Allocation failed.\n", false);
 
-        status = readSetItem(&set->items[set->set_len - 1], file, universe);
+        status = readSetItem(&set->items[set->set_len], input, universe);
         if (!status) return false;
 
             // trailing whitespace has been read
-        else if (status == EMPTY_INDEX)
-        {
-            set->items = bigBrainRealloc(set->items, --set->set_len * sizeof(int));
-
-            if (set->items == NULL && set->set_len != 0)
-                return errMsg("Allocation failed.\n", false);
+        else if (status == EMPTY_INDEX) break;
 
-            break;
-        }
+        set->set_len++;
 
         // check for duplicates in the current set
-        for (int i = 0; i < set->set_len - 1; i++)
-        {
-            if (set->items[i] == set->items[set->set_len - 1])
-                return errMsg("Duplicity in a set\n", false);
-        }
+        int item = set->items[set->set_len - 1];
+        uint64_t bit = (uint64_t) 1 << (item % BITS_PER_WORD);
+        if (scratch->seen[item / BITS_PER_WORD] & bit)
+            return errMsg("Duplicity in a set\n", false);
+        scratch->seen[item / BITS_PER_WORD] |= bit;
     } while (status != END_OF_LINE);
 
+    // clear only the bits of this line, so the bitmap is ready for the next one
+    for (int i = 0; i < set->set_len; i++)
+    {
+        scratch->seen[set->items[i] / BITS_PER_WORD] = 0;
+    }
+
     // if the loop finishes, we successfully read the set
     return true;
 }
 
-/// Decides whether the set is empty or not, and prints the result
-/// \param A a set suspected of being empty
-/// \return true when set is empty and false otherwise
-bool empty(set_t *A)
+/// Writes the buffered output to its file with a single write
+/// \param out the output to be flushed
+void outFlush(output_t *out)
 {
-    if (!A->set_len)
+    if (out->len != 0) fwrite(out->buf, 1, out->len, out->file);
+    out->flushed += out->len;
+    out->len = 0;
+}
+
+/// Appends bytes to the output buffer
+/// \param out the output to be written to
+/// \param str the bytes to be written
+/// \param len number of bytes
+void outWrite(output_t *out, const char *str, size_t len)
+{
+    if (out->len + len > OUTPUT_BUFFER_SIZE)
     {
-        printf("true\n");
-        return true;
+        outFlush(out);
+
+        // too long to be buffered at all
+        if (len > OUTPUT_BUFFER_SIZE)
+        {
+            fwrite(str, 1, len, out->file);
+            out->flushed += len;
+            return;
+        }
     }
-    printf("false\n");
+    memcpy(out->buf + out->len, str, len);
+    out->len += len;
+}
 
-    return false;
+/// Appends a string to the output buffer
+/// \param out the output to be written to
+/// \param str the '\0' terminated string to be written
+void outString(output_t *out, const char *str)
+{
+    outWrite(out, str, strlen(str));
 }
 
-/// Prints out the length of a set
-/// \param A a set of which length is to be printed
-void card(set_t *A)
+/// Appends a number to the output buffer
+/// \param out the output to be written to
+/// \param number the number to be written
+void outInt(output_t *out, int number)
 {
-    printf("%d\n", A->set_len);
+    char str[16];
+    outWrite(out, str, snprintf(str, sizeof(str), "%d", number));
 }
 
-/// Prints out a complement of a set to the universe
+/// Appends a universe item preceded by a delimiter to the output buffer, using the precomputed length of the item
+/// \param out the output to be written to
+/// \param universe the universe containing the item
+/// \param idx index of the item in the universe
+void outItem(output_t *out, universe_t *universe, int idx)
+{
+    if (out->len + MAX_STR_LEN + 1 > OUTPUT_BUFFER_SIZE) outFlush(out);
+
+    out->buf[out->len++] = DELIM;
+    memcpy(out->buf + out->len, universeItem(universe, idx), universe->lengths[idx]);
+    out->len += universe->lengths[idx];
+}
+
+/// Appends a relation pair in the form " (x y)" to the output buffer
+/// \param out the output to be written to
+/// \param universe the universe over which the pair is defined
+/// \param unit the pair to be written
+void outPair(output_t *out, universe_t *universe, relationUnit_t *unit)
+{
+    if (out->len + 2 * MAX_STR_LEN + 4 > OUTPUT_BUFFER_SIZE) outFlush(out);
+
+    out->buf[out->len++] = DELIM;
+    out->buf[out->len++] = '(';
+    memcpy(out->buf + out->len, universeItem(universe, unit->x), universe->lengths[unit->x]);
+    out->len += universe->lengths[unit->x];
+    out->buf[out->len++] = DELIM;
+    memcpy(out->buf + out->len, universeItem(universe, unit->y), universe->lengths[unit->y]);
+    out->len += universe->lengths[unit->y];
+    out->buf[out->len++] = ')';
+}
+
+/// Returns the number of words of a bitmap over the universe
+/// \param universe the universe the bitmap is defined over
+/// \return the number of 64-bit words
+int bitWords(universe_t *universe)
+{
+    return (universe->universe_len + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+/// Tests a bit of a bitmap
+/// \param bits the bitmap
+/// \param idx index of the bit
+/// \return true when the bit is set, false otherwise
+bool testBit(const uint64_t *bits, int idx)
+{
+    return (bits[idx / BITS_PER_WORD] >> (idx % BITS_PER_WORD)) & 1;
+}
+
+/// Returns the position of the lowest set bit of a word
+/// \param word a non-zero word
+/// \return the position of the lowest set bit
+int lowestBit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int position = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        position++;
+    }
+    return position;
+#endif
+}
+
+/// Returns the membership bitmap of a set, it is built on the first use and kept with the set
+/// \param set the set whose bitmap is wanted
 /// \param universe the universe over which the set is defined
-/// \param A set of which we want the complement
-/// \param dest a set where the result of the complement is stored
-/// \return false on failure of an allocation, true on success
-int complement(universe_t *universe, set_t *A, set_t *dest)
+/// \return NULL on failure of an allocation, the bitmap on success
+uint64_t *setBits(set_t *set, universe_t *universe)
 {
-    dest->items = NULL;
-    dest->set_len = 0;
+    if (set->bits != NULL) return set->bits;
 
-    for (int i = 0; i < universe->universe_len; i++) // U a b c //S a b
+    // an empty universe still gets one word, so NULL only ever means a failed allocation
+    int words = bitWords(universe) > 0 ? bitWords(universe) : 1;
+    uint64_t *bits = bigBrainRealloc(NULL, words * sizeof(uint64_t));
+    if (bits == NULL)
     {
-        int o = 0;
-        for (; o < A->set_len; o++)
-        {
-            if (A->items[o] == i) break;
-        }
-        if (o == A->set_len)
-        {
-            dest->set_len++;
-            dest->items = bigBrainRealloc(dest->items, dest->set_len *sizeof(int));
-            if (dest->items == NULL)
-                return errMsg("Allocation failed\n", false);
-            dest->items[dest->set_len - 1] = i;
-        }
+        errMsg("Allocation failed.\n", false);
+        return NULL;
     }
-    printf("S ");
-    for (int o = 0; o < dest->set_len; o++)
+
+    memset(bits, 0, words * sizeof(uint64_t));
+    for (int i = 0; i < set->set_len; i++)
     {
-        printf("%s ", universe->items[dest->items[o]]);
+        bits[set->items[i] / BITS_PER_WORD] |= (uint64_t) 1 << (set->items[i] % BITS_PER_WORD);
     }
-    printf("\n");
 
-    return true;
+    set->bits = bits;
+    return bits;
 }
 
-/// Prints out the union of two sets
-/// \param universe the universe over which the sets are defined
-/// \param A the first set to be put in the union
-/// \param B the second set to be put in the union
-/// \param dest a set where the result of the union is stored
-/// \return false on failure of an allocation, true on success
-int Union(universe_t *universe, set_t *A, set_t *B, set_t *dest)
+/// Compares two packed items for qsort
+/// \param a the first packed item
+/// \param b the second packed item
+/// \return a negative number, zero or a positive number when a is smaller, equal or bigger than b
+int compareKeys(const void *a, const void *b)
 {
-    dest->items = NULL;
-    int len;
-    set_t *bigger;
-    set_t *smaller;
-    if (A->set_len > B->set_len) bigger = A, smaller = B;
-    else bigger = B, smaller = A;
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
 
-    if (bigger->set_len != 0)
-    {
-        dest->items = bigBrainRealloc(dest->items, bigger->set_len * sizeof(int));
-        if (dest->items == NULL)
-            return errMsg("Allocation failed\n", false);
-        memcpy(dest->items, bigger->items, bigger->set_len * sizeof(int));
-    }
-    len = bigger->set_len;
+/// Compares two items for qsort
+/// \param a the first item
+/// \param b the second item
+/// \return a negative number, zero or a positive number when a is smaller, equal or bigger than b
+int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
 
-    int j;
-    for (int i = 0; i < bigger->set_len; i++)
-    {
-        for (j = 0; j < smaller->set_len; j++)
-        {
-            if (smaller->items[j] == bigger->items[i])
-            {
-                j = 0;
-                break;
-            }
-        }
-        if (j != 0)
-        {
-            int o = 0;
-            for (; o < len; o++)
-            {
-                if (dest->items[o] == smaller->items[j-1])
-                {
-                    o = -1;
-                    break;
-                }
-            }
-            if (o == -1) break;
-            len++;
-            dest->items = bigBrainRealloc(dest->items, len * sizeof(int));
-            if (dest->items == NULL && len > 0)
-                return errMsg("Allocation failed\n", false);
+/// Returns the sorted view of a set, it is built on the first use and kept with the set
+/// \param set the set whose sorted view is wanted
+/// \return NULL on failure of an allocation or for an empty set, the sorted items otherwise
+uint64_t *setSorted(set_t *set)
+{
+    if (set->sorted != NULL || set->set_len == 0) return set->sorted;
 
-            memcpy(&dest->items[len - 1], &smaller->items[j-1], sizeof(int));
-        }
+    uint64_t *sorted = bigBrainRealloc(NULL, set->set_len * sizeof(uint64_t));
+    if (sorted == NULL)
+    {
+        errMsg("Allocation failed.\n", false);
+        return NULL;
     }
-    dest->set_len = len;
-    printf("S");
-    for (int i = 0; i < len; i++)
+
+    // the position rides along in the low half, so the original order can be recovered
+    for (int i = 0; i < set->set_len; i++)
     {
-        printf(" %s", universe->items[dest->items[i]]);
+        sorted[i] = (uint64_t) set->items[i] << 32 | (uint32_t) i;
     }
-    printf("\n");
-    return true;
+    qsort(sorted, set->set_len, sizeof(uint64_t), compareKeys);
+
+    set->sorted = sorted;
+    return sorted;
 }
 
-/// Prints out the intersection of two sets
-/// \param universe the universe over which the sets are defined
-/// \param A the first set in the intersection
-/// \param B the second set in the intersection
-/// \param dest a set where the result of the intersect is stored
-/// \return false on failure of an allocation, true on success
-int intersect(universe_t *universe, set_t *A, set_t *B, set_t *dest)
+/// Finds the first packed item whose item is not smaller than the wanted one, by exponential and then binary search
+/// \param sorted the sorted items
+/// \param from position the search starts at
+/// \param len number of the sorted items
+/// \param item the wanted item
+/// \return position of the first packed item not smaller than the wanted one, len when there is none
+int gallop(const uint64_t *sorted, int from, int len, int item)
 {
-    dest->items = NULL;
-    dest->set_len = 0;
+    uint64_t key = (uint64_t) item << 32;
+    int step = 1, lo = from, hi = from;
 
-    printf("S");
-    for (int i = 0; i < A->set_len; i++)
+    while (hi < len && sorted[hi] < key)
     {
-        for (int j = 0; j < B->set_len; j++)
-        {
-            if (A->items[i] == B->items[j])
-            {
-                printf(" %s", universe->items[A->items[i]]);
-                dest->items = bigBrainRealloc(dest->items, ++dest->set_len * sizeof(int));
-                if (dest->items == NULL && dest->set_len > 0) return errMsg("Allocation failed\n", false);
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > len) hi = len;
 
-                dest->items[dest->set_len - 1] = A->items[i];
-                break;
-            }
-        }
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (sorted[mid] < key) lo = mid + 1;
+        else hi = mid;
     }
-    printf("\n");
-    return true;
+    return lo;
 }
 
-/// Prints out the result of a subtraction of a set B from set A
-/// \param universe the universe over which the sets are defined
-/// \param A the set from which elements are subtracted
-/// \param B the set containing the subtracted elements
-/// \param dest a set where the result of the subtraction is stored
+/// Counts the set bits of a word
+/// \param word the word
+/// \return the number of set bits
+int countBits(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word != 0; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+/// Returns the number of chunks the universe is split into by the adaptive representation
+/// \param universe the universe
+/// \return the number of chunks
+int chunkCount(universe_t *universe)
+{
+    return (universe->universe_len + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+/// Returns the number of bitmap words covering a chunk, only the last chunk of the universe can be shorter
+/// \param universe the universe
+/// \param chunk index of the chunk
+/// \return the number of words
+int chunkWords(universe_t *universe, int chunk)
+{
+    int items = universe->universe_len - chunk * CHUNK_SIZE;
+    return items >= CHUNK_SIZE ? CHUNK_WORDS : (items + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+/// Encodes the bitmap of a chunk into the smallest of the array, bitmap and run containers
+/// \param container the container to be filled
+/// \param words bitmap of the chunk
+/// \param wordCount number of words of the bitmap
 /// \return false on failure of an allocation, true on success
-int minus(universe_t *universe, set_t *A, set_t *B, set_t *dest)
+int fillContainer(container_t *container, const uint64_t *words, int wordCount)
 {
-    dest->items = NULL;
-    dest->set_len = 0;
+    // a run starts at every set bit whose lower neighbour is not set
+    int count = 0, runs = 0;
+    uint64_t carry = 0;
+    for (int w = 0; w < wordCount; w++)
+    {
+        count += countBits(words[w]);
+        runs += countBits(words[w] & ~(words[w] << 1 | carry));
+        carry = words[w] >> (BITS_PER_WORD - 1);
+    }
 
-    printf("S");
-    for (int i = 0; i < A->set_len; i++)
+    size_t arrayBytes = count * sizeof(uint16_t), runBytes = 2 * runs * sizeof(uint16_t);
+    size_t bitmapBytes = wordCount * sizeof(uint64_t);
+    container->values = NULL;
+    container->words = NULL;
+
+    if (bitmapBytes < arrayBytes && bitmapBytes < runBytes)
     {
-        int status = 0;
-        for (int j = 0; j < B->set_len; j++)
+        container->kind = CONTAINER_BITMAP;
+        container->len = wordCount;
+        container->words = bigBrainRealloc(NULL, bitmapBytes);
+        if (container->words == NULL) return false;
+        memcpy(container->words, words, bitmapBytes);
+    }
+    else
+    {
+        container->kind = runBytes < arrayBytes ? CONTAINER_RUN : CONTAINER_ARRAY;
+        container->len = container->kind == CONTAINER_RUN ? runs : count;
+        if (count != 0)
         {
-            if (A->items[i] == B->items[j])
-            {
-                status = EMPTY_INDEX;
-                break;
-            }
+            container->values = bigBrainRealloc(NULL, container->kind == CONTAINER_RUN ? runBytes : arrayBytes);
+            if (container->values == NULL) return false;
         }
-        if (status != EMPTY_INDEX)
-        {
-            printf(" %s", universe->items[A->items[i]]);
-            dest->items = bigBrainRealloc(dest->items, ++dest->set_len * sizeof(int));
-            if (dest->items == NULL && dest->set_len > 0)
-                return errMsg("Allocation failed\n", false);
 
-            dest->items[dest->set_len - 1] = A->items[i];
+        int n = 0;
+        for (int w = 0; w < wordCount; w++)
+        {
+            for (uint64_t word = words[w]; word != 0; word &= word - 1)
+            {
+                int offset = w * BITS_PER_WORD + lowestBit(word);
+                if (container->kind == CONTAINER_ARRAY) container->values[n++] = offset;
+                else if (n > 0 && container->values[n - 1] == offset - 1) container->values[n - 1] = offset;
+                else
+                {
+                    container->values[n++] = offset;
+                    container->values[n++] = offset;
+                }
+            }
         }
     }
-    printf("\n");
+
+#ifdef SETCAL_STATS
+    containerCount[container->kind]++;
+    containerBytes[container->kind] += container->kind == CONTAINER_BITMAP ? bitmapBytes :
+                                       container->kind == CONTAINER_RUN ? runBytes : arrayBytes;
+#endif
     return true;
 }
 
-/// Prints true when the set A is a subset of the set B, and false otherwise. Or returns the same boolean value when print == true
-/// \param A a set that is a suspected subset of the set B
-/// \param B a set that is a suspected superset of the set A
-/// \param print decides whether the result is to be printed or returned, true to be printed and false to be returned
-/// \return true when the set A is a subset of the set B, false otherwise
-bool subseteq(set_t *A, set_t *B, bool print)
+/// Returns the adaptive containers of a set, they are built on the first use and kept with the set
+/// \param set the set whose containers are wanted
+/// \param universe the universe over which the set is defined
+/// \return NULL on failure of an allocation, the containers on success
+container_t *setChunks(set_t *set, universe_t *universe)
 {
-    int count = 0;
-    for (int i = 0; i < A->set_len; i++)
+    if (set->chunks != NULL) return set->chunks;
+
+    // the items are grouped by their chunk, so each chunk is encoded from one small bitmap
+    int chunks = chunkCount(universe);
+    container_t *containers = bigBrainRealloc(NULL, (chunks > 0 ? chunks : 1) * sizeof(container_t));
+    int *starts = bigBrainRealloc(NULL, (chunks + 1) * sizeof(int));
+    uint16_t *offsets = set->set_len > 0 ? bigBrainRealloc(NULL, set->set_len * sizeof(uint16_t)) : NULL;
+    uint64_t *words = bigBrainRealloc(NULL, CHUNK_WORDS * sizeof(uint64_t));
+    if (containers == NULL || starts == NULL || words == NULL || (offsets == NULL && set->set_len > 0))
     {
-        for (int j = 0; j < B->set_len; j++)
-        {
-            if (A->items[i] == B->items[j])
-            {
-                count++;
-            }
-        }
+        errMsg("Allocation failed.\n", false);
+        return NULL;
     }
 
-    if(!print && count == A->set_len)
+    memset(starts, 0, (chunks + 1) * sizeof(int));
+    for (int i = 0; i < set->set_len; i++)
     {
-        return true;
+        starts[(set->items[i] >> CHUNK_BITS) + 1]++;
     }
-    else if (print && count == A->set_len)
+    for (int c = 0; c < chunks; c++)
     {
-        printf("true\n");
-        return true;
+        starts[c + 1] += starts[c];
     }
-    else if (print && count != A->set_len)
+    for (int i = 0; i < set->set_len; i++)
     {
-        printf("false\n");
-        return false;
+        offsets[starts[set->items[i] >> CHUNK_BITS]++] = set->items[i] & (CHUNK_SIZE - 1);
     }
-    else
+
+    // the scatter moved every start to the end of its chunk, which is the start of the next one
+    for (int c = 0, from = 0; c < chunks; c++)
     {
-        return false;
+        int wordCount = chunkWords(universe, c);
+        memset(words, 0, wordCount * sizeof(uint64_t));
+        for (; from < starts[c]; from++)
+        {
+            words[offsets[from] / BITS_PER_WORD] |= (uint64_t) 1 << (offsets[from] % BITS_PER_WORD);
+        }
+
+        if (!fillContainer(&containers[c], words, wordCount))
+        {
+            errMsg("Allocation failed.\n", false);
+            return NULL;
+        }
     }
+
+    set->chunks = containers;
+    return containers;
 }
 
-/// Prints true when the set A is a proper subset of the set B, and false otherwise
-/// \param A a set that is a suspected proper subset of the set B
-/// \param B a set that is a suspected superset of the set A
-/// \return true when the set A is a proper subset of the set B, false otherwise
-bool subset(set_t *A, set_t *B) {
-    int control = subseteq(A, B, false);
-    if (control == 1 && A->set_len < B->set_len)
-    {
-        printf("true\n");
-        return true;
-    }
-    else
+/// Checks whether a container holds an offset
+/// \param container the container
+/// \param offset the offset of the item within its chunk
+/// \return true when the offset is held by the container, false otherwise
+bool containerHas(const container_t *container, int offset)
+{
+    if (container->kind == CONTAINER_BITMAP) return testBit(container->words, offset);
+
+    // the runs are searched for the last one starting at or before the offset
+    int step = container->kind == CONTAINER_RUN ? 2 : 1;
+    int lo = 0, hi = container->len;
+    while (lo < hi)
     {
-        printf("false\n");
-        return false;
+        int mid = lo + (hi - lo) / 2;
+        if (container->values[mid * step] <= offset) lo = mid + 1;
+        else hi = mid;
     }
+    return lo > 0 && container->values[(lo - 1) * step + step - 1] >= offset;
 }
 
-/// Prints true when the sets are equal and false otherwise
-/// \param A the first set of the comparison
-/// \param B the second set of the comparison
-/// \return true when the sets are equal, false otherwise
-bool equals(set_t *A, set_t *B)
+/// Finds which items of the set X are also items of the set Y, using the representation chosen by setBackend \n
+/// The sorted backend merges both sorted views and gallops through the bigger one when their sizes differ a lot
+/// \param universe the universe over which the sets are defined
+/// \param X the set whose items are looked up
+/// \param Y the set the items are looked up in
+/// \param found array of |X| flags marking the items of X found in Y, NULL when only the count is wanted
+/// \return the number of items of X found in Y, INVALID_INDEX on failure of an allocation
+int countMembers(universe_t *universe, set_t *X, set_t *Y, bool *found)
 {
-    if (!A->set_len && !B->set_len)
-    {
-        printf("true\n");
-        return true;
-    }
-    else if (A->set_len != B->set_len)
-    {
-        printf("false\n");
-        return false;
-    }
+    int count = 0;
+    if (found != NULL && X->set_len != 0) memset(found, 0, X->set_len * sizeof(bool));
+    if (X->set_len == 0 || Y->set_len == 0) return 0;
 
-    for (int i = 0; i < A->set_len; i++)
+    if (setBackend == BACKEND_BITMAP)
     {
-        bool status = false;
-        for (int j = 0; j < A->set_len; j++)
+        uint64_t *bits = setBits(Y, universe);
+        if (bits == NULL) return INVALID_INDEX;
+
+        for (int i = 0; i < X->set_len; i++)
         {
-            if (A->items[i] == B->items[j])
+            if (testBit(bits, X->items[i]))
             {
-                status = true;
-                break;
+                if (found != NULL) found[i] = true;
+                count++;
             }
         }
-        if (!status)
+        return count;
+    }
+
+    if (setBackend == BACKEND_ADAPTIVE)
+    {
+        container_t *chunks = setChunks(Y, universe);
+        if (chunks == NULL) return INVALID_INDEX;
+
+        for (int i = 0; i < X->set_len; i++)
         {
-            printf("false\n");
-            return false;
+            if (containerHas(&chunks[X->items[i] >> CHUNK_BITS], X->items[i] & (CHUNK_SIZE - 1)))
+            {
+                if (found != NULL) found[i] = true;
+                count++;
+            }
         }
+        return count;
     }
-    printf("true\n");
-    return true;
-}
 
-/// Prints true when the relation is reflexive and false otherwise
-/// \param uni the universe over which the relation is defined
-/// \param R relation that is suspected of being reflexive
-/// \return true when the relation is reflexive, false otherwise
-bool reflexive(universe_t *uni, relation_t *R)
-{
-    int reflexiveUnitsCount = 0;
-    for (int i = 0; i < R->relation_len; i++)
+    uint64_t *x = setSorted(X), *y = setSorted(Y);
+    if (x == NULL || y == NULL) return INVALID_INDEX;
+
+    bool skewed = X->set_len > GALLOP_RATIO * Y->set_len || Y->set_len > GALLOP_RATIO * X->set_len;
+    int i = 0, j = 0;
+    while (i < X->set_len && j < Y->set_len)
     {
-        if (R->items[i].x == R->items[i].y)
+        int a = x[i] >> 32, b = y[j] >> 32;
+        if (a == b)
         {
-            reflexiveUnitsCount++;
+            if (found != NULL) found[(uint32_t) x[i]] = true;
+            count++;
+            i++;
+            j++;
         }
+        else if (a < b) i = skewed ? gallop(x, i, X->set_len, b) : i + 1;
+        else j = skewed ? gallop(y, j, Y->set_len, a) : j + 1;
     }
-    if (reflexiveUnitsCount == uni->universe_len)
+    return count;
+}
+
+/// Decides whether the set is empty or not, and prints the result
+/// \param A a set suspected of being empty
+/// \param out the output the result is written to
+/// \return true when set is empty and false otherwise
+bool empty(set_t *A, output_t *out)
+{
+    if (!A->set_len)
     {
-        printf("true\n");
+        outString(out, "true\n");
         return true;
     }
-    printf("false\n");
+    outString(out, "false\n");
+
     return false;
 }
 
-/// Prints true when the relation is symmetric and false otherwise
-/// \param R relation that is suspected of being symmetric
-/// \return true when the relation is symmetric, false otherwise
-bool symmetric(relation_t *R)
+/// Prints out the length of a set
+/// \param A a set of which length is to be printed
+/// \param out the output the result is written to
+void card(set_t *A, output_t *out)
 {
-    for (int i = 0; i < R->relation_len; i++)
-    {
-        bool hasSymmetricUnit = false;
-        for (int j = 0; j < R->relation_len; j++)
-        {
-            if (R->items[i].x == R->items[j].y && R->items[j].x == R->items[i].y)
-            {
-                hasSymmetricUnit = true;
-            }
-        }
-        if (!hasSymmetricUnit)
-        {
-            printf("false\n");
-            return false;
-        }
-    }
-    printf("true\n");
-    return true;
+    outInt(out, A->set_len);
+    outString(out, "\n");
 }
 
-/// Prints true when the relation is antisymmetric and false otherwise
-/// \param R relation that is suspected of being antisymmetric
-/// \return true when the relation is antisymmetric, false otherwise
-bool antisymmetric(relation_t *R)
+/// Prints out a complement of a set to the universe
+/// \param universe the universe over which the set is defined
+/// \param A set of which we want the complement
+/// \param dest a set where the result of the complement is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+int complement(universe_t *universe, set_t *A, set_t *dest, output_t *out)
 {
-    for (int i = 0; i < R->relation_len; i++)
+    dest->items = NULL;
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
+
+    // the set has no duplicates, so the complement has exactly |U| - |A| items
+    if (universe->universe_len > A->set_len)
+    {
+        dest->items = bigBrainRealloc(NULL, (universe->universe_len - A->set_len) * sizeof(int));
+        if (dest->items == NULL)
+            return errMsg("Allocation failed\n", false);
+    }
+
+    if (setBackend == BACKEND_BITMAP)
     {
-        for (int j = 0; j < R->relation_len; j++)
+        uint64_t *bits = setBits(A, universe);
+        int words = bitWords(universe);
+        dest->bits = bigBrainRealloc(NULL, (words > 0 ? words : 1) * sizeof(uint64_t));
+        if (bits == NULL || dest->bits == NULL)
+            return errMsg("Allocation failed\n", false);
+
+        // the complement is taken a word at a time, its items come out in the order of the universe
+        for (int w = 0; w < words; w++)
         {
-            if (R->items[i].x == R->items[j].y && R->items[j].x == R->items[i].y && R->items[i].x != R->items[i].y)
+            uint64_t word = ~bits[w];
+            if (w == words - 1 && universe->universe_len % BITS_PER_WORD != 0)
+                word &= ((uint64_t) 1 << (universe->universe_len % BITS_PER_WORD)) - 1;
+            dest->bits[w] = word;
+
+            for (; word != 0; word &= word - 1)
             {
-                printf("false\n");
-                return false;
+                dest->items[dest->set_len++] = w * BITS_PER_WORD + lowestBit(word);
             }
         }
     }
-    printf("true\n");
-    return true;
-}
-
-/// Prints true when the relation is transitive and false otherwise
-/// \param R relation that is suspected of being transitive
-/// \return true when the relation is transitive, false otherwise
-bool transitive(relation_t *R)
-{
-    for (int i = 0; i < R->relation_len; i++)
+    else if (setBackend == BACKEND_ADAPTIVE)
     {
-        for (int j = 0; j < R->relation_len; j++)
+        container_t *chunks = setChunks(A, universe);
+        if (chunks == NULL) return false;
+
+        for (int c = 0; c < chunkCount(universe); c++)
         {
-            if (R->items[i].y == R->items[j].x)
+            int base = c * CHUNK_SIZE;
+            int end = universe->universe_len - base < CHUNK_SIZE ? universe->universe_len - base : CHUNK_SIZE;
+            container_t *container = &chunks[c];
+
+            if (container->kind == CONTAINER_BITMAP)
             {
-                bool status = false;
-                for (int k = 0; k < R->relation_len; k++)
+                for (int w = 0; w < container->len; w++)
                 {
-                    if (R->items[k].x == R->items[i].x && R->items[k].y == R->items[j].y)
+                    for (uint64_t word = ~container->words[w]; word != 0; word &= word - 1)
                     {
-                        status = true;
-                        break;
+                        int offset = w * BITS_PER_WORD + lowestBit(word);
+                        if (offset < end) dest->items[dest->set_len++] = base + offset;
                     }
                 }
-                if (!status)
+                continue;
+            }
+
+            // an array is a sequence of runs of one item, the complement fills the gaps between the runs
+            int step = container->kind == CONTAINER_RUN ? 2 : 1, next = 0;
+            for (int r = 0; r <= container->len; r++)
+            {
+                int first = r < container->len ? container->values[r * step] : end;
+                for (; next < first; next++)
                 {
-                    printf("false\n");
-                    return false;
+                    dest->items[dest->set_len++] = base + next;
                 }
+                if (r < container->len) next = container->values[r * step + step - 1] + 1;
             }
         }
     }
-    printf("true\n");
-    return true;
-}
-
-/// Prints true when the relation is a function and false otherwise
-/// \param R relation that is suspected of being a function
-/// \return true when the relation is a function, false otherwise
-bool function(relation_t *R)
-{
-    for (int i = 0; i < R->relation_len; i++)
+    else
     {
-        for (int j = 0; j < R->relation_len; j++)
+        uint64_t *sorted = setSorted(A);
+        if (sorted == NULL && A->set_len != 0) return false;
+
+        // the gaps between the sorted items are exactly the complement, in the order of the universe
+        int next = 0;
+        for (int i = 0; i <= A->set_len; i++)
         {
-            if ((R->items[i].x == R->items[j].x) && (R->items[i].y != R->items[j].y))
+            int end = i < A->set_len ? (int) (sorted[i] >> 32) : universe->universe_len;
+            for (; next < end; next++)
             {
-                printf("false\n");
-                return false;
+                dest->items[dest->set_len++] = next;
             }
+            next = end + 1;
         }
     }
 
-    printf("true\n");
+    outString(out, "S");
+    for (int o = 0; o < dest->set_len; o++)
+    {
+        outItem(out, universe, dest->items[o]);
+    }
+    outString(out, " \n");
+
     return true;
 }
 
-/// Prints out the domain of the relation
-/// \param uni the universe over which the relation is defined
-/// \param R relation where we search for its domain
-/// \param dest a set where the result of the domain is stored
+/// Prints out the union of two sets
+/// \param universe the universe over which the sets are defined
+/// \param A the first set to be put in the union
+/// \param B the second set to be put in the union
+/// \param dest a set where the result of the union is stored
+/// \param out the output the result is written to
 /// \return false on failure of an allocation, true on success
-bool domain(universe_t *uni, relation_t *R, set_t *dest)
+int Union(universe_t *universe, set_t *A, set_t *B, set_t *dest, output_t *out)
 {
     dest->items = NULL;
-    dest->set_len = R->relation_len;
-    if (R->relation_len != 0)
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
+    set_t *bigger;
+    set_t *smaller;
+    if (A->set_len > B->set_len) bigger = A, smaller = B;
+    else bigger = B, smaller = A;
+
+    // the union has at most |A| + |B| items
+    bool *found = NULL;
+    if (smaller->set_len != 0 && (found = bigBrainRealloc(NULL, smaller->set_len * sizeof(bool))) == NULL)
+        return errMsg("Allocation failed\n", false);
+    if (countMembers(universe, smaller, bigger, found) == INVALID_INDEX) return false;
+
+    // the items are allocated last, so they can be released again when the result turns out to be a duplicate
+    if (bigger->set_len != 0)
     {
-        dest->items = malloc(R->relation_len * sizeof(int));
+        dest->items = bigBrainRealloc(NULL, (bigger->set_len + smaller->set_len) * sizeof(int));
         if (dest->items == NULL)
-            return false;
+            return errMsg("Allocation failed\n", false);
+        memcpy(dest->items, bigger->items, bigger->set_len * sizeof(int));
     }
-    int domainCount = 0;
+    dest->set_len = bigger->set_len;
 
-    printf("S");
-    for (int i = 0; i < R->relation_len; i++)
+    // append the items of the smaller set missing from the bigger one
+    for (int i = 0; i < smaller->set_len; i++)
     {
-        bool status = false;
-        for (int j = 0; j < domainCount; j++)
-        {
-            if (R->items[i].x == dest->items[j])
-            {
-                status = true;
-                break;
-            }
-        }
-        if (!status)
+        if (!found[i])
         {
-            printf(" %s", uni->items[R->items[i].x]);
-            dest->items[domainCount] = R->items[i].x;
-            domainCount++;
+            dest->items[dest->set_len++] = smaller->items[i];
         }
     }
-    printf("\n");
+
+    outString(out, "S");
+    for (int i = 0; i < dest->set_len; i++)
+    {
+        outItem(out, universe, dest->items[i]);
+    }
+    outString(out, "\n");
     return true;
 }
 
-/// Prints out the codomain of the relation
-/// \param uni the universe over which the relation is defined
-/// \param R relation where we search for its codomain
-/// \param dest a set where the result of the codomain is stored
+/// Prints out the intersection of two sets
+/// \param universe the universe over which the sets are defined
+/// \param A the first set in the intersection
+/// \param B the second set in the intersection
+/// \param dest a set where the result of the intersect is stored
+/// \param out the output the result is written to
 /// \return false on failure of an allocation, true on success
-bool codomain(universe_t *uni, relation_t *R, set_t *dest)
+int intersect(universe_t *universe, set_t *A, set_t *B, set_t *dest, output_t *out)
 {
     dest->items = NULL;
-    dest->set_len = R->relation_len;
-    if (R->relation_len != 0)
-    {
-        dest->items = malloc(R->relation_len * sizeof(int));
-        if (dest->items == NULL)
-            return false;
-    }
-    int domainCount = 0;
-    printf("S");
-    for (int i = 0; i < R->relation_len; i++)
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
+
+    // the intersection has at most min(|A|, |B|) items
+    bool *found = NULL;
+    int bound = A->set_len < B->set_len ? A->set_len : B->set_len;
+    if (bound != 0 && (found = bigBrainRealloc(NULL, A->set_len * sizeof(bool))) == NULL)
+        return errMsg("Allocation failed\n", false);
+    if (countMembers(universe, A, B, found) == INVALID_INDEX) return false;
+    if (bound != 0 && (dest->items = bigBrainRealloc(NULL, bound * sizeof(int))) == NULL)
+        return errMsg("Allocation failed\n", false);
+
+    outString(out, "S");
+    for (int i = 0; i < A->set_len && bound != 0; i++)
     {
-        bool status = false;
-        for (int j = 0; j < domainCount; j++)
-        {
-            if (R->items[i].y == dest->items[j])
-            {
-                status = true;
-                break;
-            }
-        }
-        if (!status)
+        if (found[i])
         {
-            printf(" %s", uni->items[R->items[i].y]);
-            dest->items[domainCount] = R->items[i].y;
-            domainCount++;
+            outItem(out, universe, A->items[i]);
+            dest->items[dest->set_len++] = A->items[i];
         }
     }
-    printf("\n");
+    outString(out, "\n");
     return true;
 }
 
-/// Prints the universe contents to stdout
-/// \param universe the universe to be printed
-void printUniverse(universe_t *universe)
-{
-    printf("U");
-    for (int i = 0; i < universe->universe_len; i++)
-    {
-        printf(" %s", universe->items[i]);
-    }
-    printf("\n");
-}
-
-/// Prints set contents to stdout
-/// \param set the set to be printed
-/// \param universe the universe the set members belong to
-void printSet(set_t *set, universe_t *universe)
+/// Prints out the result of a subtraction of a set B from set A
+/// \param universe the universe over which the sets are defined
+/// \param A the set from which elements are subtracted
+/// \param B the set containing the subtracted elements
+/// \param dest a set where the result of the subtraction is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+int minus(universe_t *universe, set_t *A, set_t *B, set_t *dest, output_t *out)
 {
-    if (set->index == 1)
+    dest->items = NULL;
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
+
+    // the difference has at most |A| items
+    bool *found = NULL;
+    if (A->set_len != 0 && (found = bigBrainRealloc(NULL, A->set_len * sizeof(bool))) == NULL)
+        return errMsg("Allocation failed\n", false);
+    if (countMembers(universe, A, B, found) == INVALID_INDEX) return false;
+    if (A->set_len != 0 && (dest->items = bigBrainRealloc(NULL, A->set_len * sizeof(int))) == NULL)
+        return errMsg("Allocation failed\n", false);
+
+    outString(out, "S");
+    for (int i = 0; i < A->set_len; i++)
     {
-        printf("U");
-        for (int i = 0; i < set->set_len; i++)
+        if (!found[i])
         {
-            printf(" %s", universe->items[set->items[i]]);
+            outItem(out, universe, A->items[i]);
+            dest->items[dest->set_len++] = A->items[i];
         }
-        printf("\n");
-        return;
     }
-    printf("S");
-    for (int i = 0; i < set->set_len; i++)
-    {
-        printf(" %s", universe->items[set->items[i]]);
-    }
-    printf("\n");
+    outString(out, "\n");
+    return true;
 }
 
-/// Prints relation contents to stdout
-/// \param relation the relation to be printed
-/// \param universe the universe the relation members belong to
-void printRelation(relation_t *relation, universe_t *universe)
+/// Checks whether all items of the set A are items of the set B
+/// \param universe the universe over which the sets are defined
+/// \param A a set that is a suspected subset of the set B
+/// \param B a set that is a suspected superset of the set A
+/// \return true when the set A is a subset of the set B, false otherwise or on failure of an allocation
+bool containsAll(universe_t *universe, set_t *A, set_t *B)
 {
-    printf("R");
-    for (int i = 0; i < relation->relation_len; i++)
+    // identical sets share their items, so equal storage means equal sets
+    if (A->items == B->items && A->set_len == B->set_len) return true;
+
+    // the fingerprints answer most comparisons, a subset lies within the bounds of its superset
+    // and cannot have a bit of the signature the superset lacks, equal sized sets have to be equal
+    if (A->set_len > B->set_len || A->set_len == 0 || A->min < B->min || A->max > B->max ||
+        (A->signature & ~B->signature) != 0 || (A->set_len == B->set_len && A->hash != B->hash))
     {
-        printf(" (%s %s)", universe->items[relation->items[i].x], universe->items[relation->items[i].y]);
+#ifdef SETCAL_STATS
+        fingerprintDecided++;
+#endif
+        return A->set_len <= B->set_len && A->set_len == 0;
     }
-    printf("\n");
-}
+#ifdef SETCAL_STATS
+    fingerprintExact++;
+#endif
 
-/// Prints all file contents to stdout
-/// \param universe list of all universe contents to be printed
-/// \param relations list of all relation contents to be printed
-/// \param sets list of all set contents to be printed
-void printFile(universe_t *universe, relationList_t *relations, setList_t *sets)
-{
-    printUniverse(universe);
-    int i = 0, j = 1;
-    while (i < relations->relationList_len && j < sets->setList_len)
+    // both bitmaps are known, so whole words are compared at once
+    if (setBackend == BACKEND_BITMAP && A->bits != NULL && B->bits != NULL)
     {
-        if (relations->relations[i].index < sets->sets[j].index)
-        {
-            printRelation(&relations->relations[i], universe);
-            i++;
-        }
-        else
+        int words = bitWords(universe);
+        uint64_t missing = 0;
+        for (int w = 0; w < words; w++)
         {
-            printSet(&sets->sets[j], universe);
-            j++;
+            missing |= A->bits[w] & ~B->bits[w];
         }
+        return missing == 0;
     }
-    while (i < relations->relationList_len) printRelation(&relations->relations[i++], universe);
-    while (j < sets->setList_len) printSet(&sets->sets[j++], universe);
+
+    return countMembers(universe, A, B, NULL) == A->set_len;
 }
 
-///Checks whether the relation members are part of the set
-/// \param R relation that we are checking
-/// \param S set that is part of a relation on a first/second position
-/// \param memberPosition position of a set in a relation (x,y)
-/// \return true when the relation members were found in the sets, false otherwise
-bool areRelationMembersInSet(relation_t *R, set_t *S, int memberPosition)
+/// Prints true when the set A is a subset of the set B, and false otherwise. Or returns the same boolean value when print == true
+/// \param universe the universe over which the sets are defined
+/// \param A a set that is a suspected subset of the set B
+/// \param B a set that is a suspected superset of the set A
+/// \param print decides whether the result is to be printed or returned, true to be printed and false to be returned
+/// \param out the output the result is written to
+/// \return true when the set A is a subset of the set B, false otherwise
+bool subseteq(universe_t *universe, set_t *A, set_t *B, bool print, output_t *out)
 {
-    for (int i = 0; i < R->relation_len; i++)
-    {
-        bool status = false;
-        if (memberPosition == 1)
-        {
-            for (int j = 0; j < S->set_len; j++)
-            {
-                if (R->items[i].x == S->items[j])
-                {
-                    status = true;
-                }
-            }
-        }
-        else if (memberPosition == 2)
-        {
-            for (int j = 0; j < S->set_len; j++)
-            {
-                if (R->items[i].y == S->items[j])
-                {
-                    status = true;
-                    break;
-                }
-            }
-        }
-        else
-        {
-            return false;
-        }
+    bool result = containsAll(universe, A, B);
 
-        if (!status)
-        {
-            return false;
-        }
+    if (print) outString(out, result ? "true\n" : "false\n");
+    return result;
+}
+
+/// Prints true when the set A is a proper subset of the set B, and false otherwise
+/// \param universe the universe over which the sets are defined
+/// \param A a set that is a suspected proper subset of the set B
+/// \param B a set that is a suspected superset of the set A
+/// \param out the output the result is written to
+/// \return true when the set A is a proper subset of the set B, false otherwise
+bool subset(universe_t *universe, set_t *A, set_t *B, output_t *out) {
+    // a proper subset is smaller, so the containment is only checked when the sizes allow it
+    if (A->set_len < B->set_len && subseteq(universe, A, B, false, out))
+    {
+        outString(out, "true\n");
+        return true;
+    }
+    else
+    {
+        outString(out, "false\n");
+        return false;
     }
-    return true;
 }
 
-/// Checks whether the domain of a relation is complete
-/// \param R checked relation
-/// \param S the wanted domain
-/// \return false when the domain is incomplete, true otherwise
-bool isRelDomainComplete(relation_t *R, set_t *S)
+/// Prints true when the sets are equal and false otherwise
+/// \param universe the universe over which the sets are defined
+/// \param A the first set of the comparison
+/// \param B the second set of the comparison
+/// \param out the output the result is written to
+/// \return true when the sets are equal, false otherwise
+bool equals(universe_t *universe, set_t *A, set_t *B, output_t *out)
 {
-    for (int i = 0; i < S->set_len; i++)
+    // sets of the same size are equal when one contains the other
+    if (A->set_len != B->set_len || !containsAll(universe, A, B))
     {
-        bool status = false;
-        for (int j = 0; j < R->relation_len; j++)
-        {
-            if (S->items[i] == R->items[j].x)
-            {
-                status = true;
-            }
-        }
-        if (!status)
-        {
-            return false;
-        }
+        outString(out, "false\n");
+        return false;
     }
+    outString(out, "true\n");
     return true;
 }
 
-/// Prints true when the relation function is injective and false otherwise
-/// \param R relation of the sets (A,B)
-/// \param A set indicating the domain of a function
-/// \param B set indicating the codomain of a function
-/// \return true when the relation is injective, false otherwise
-bool injective(relation_t *R, set_t *A, set_t *B)
+/// Groups the items of a relation by a key with a counting sort, the groups keep the order the items are visited in
+/// \param start |U| + 1 group offsets to be filled
+/// \param groups the grouped items to be filled
+/// \param keys key of every visited item
+/// \param values the visited items
+/// \param count number of visited items
+/// \param universe_len number of possible keys
+void groupByKey(int *start, int *groups, const int *keys, const int *values, int count, int universe_len)
 {
-    if ((areRelationMembersInSet(R, A, 1) && areRelationMembersInSet(R, B, 2)) && isRelDomainComplete(R, A))
+    memset(start, 0, (universe_len + 1) * sizeof(int));
+    for (int i = 0; i < count; i++)
     {
-        for (int i = 0; i < R->relation_len; i++)
-        {
-            for (int j = 0; j < R->relation_len; j++)
-            {
-                if (R->items[i].y == R->items[j].y && R->items[i].x != R->items[j].x)
-                {
-                    printf("false\n");
-                    return false;
-                }
-            }
-        }
-        return function(R);
+        start[keys[i] + 1]++;
     }
-    else
+    for (int k = 0; k < universe_len; k++)
     {
-        printf("false\n");
-        return false;
+        start[k + 1] += start[k];
+    }
+    for (int i = 0; i < count; i++)
+    {
+        groups[start[keys[i]]++] = values[i];
+    }
+
+    // the scatter moved every offset to the end of its group, shift them back
+    for (int k = universe_len; k > 0; k--)
+    {
+        start[k] = start[k - 1];
     }
+    start[0] = 0;
 }
 
-/// Prints true when the relation function is surjective and false otherwise
-/// \param R relation of the sets (A,B)
-/// \param A set indicating the domain of a function
-/// \param B set indicating the codomain of a function
-/// \return true when the relation is surjective, false otherwise
-bool surjective(relation_t *R, set_t *A, set_t *B)
+/// Returns the adjacency index of a relation, it is built on the first use and kept with the relation \n
+/// The pairs are grouped by the second item first, so regrouping them by the first item leaves every
+/// successor list sorted, and regrouping those again sorts the predecessor lists, all in O(|U| + |R|)
+/// \param R the relation whose index is wanted
+/// \param universe the universe over which the relation is defined
+/// \return NULL on failure of an allocation, the index on success
+relIndex_t *relationIndex(relation_t *R, universe_t *universe)
 {
-    if (A->set_len < B->set_len)
+    if (R->csr != NULL) return R->csr;
+
+    int n = universe->universe_len, len = R->relation_len;
+    relIndex_t *csr = bigBrainRealloc(NULL, sizeof(relIndex_t));
+    int *xs = bigBrainRealloc(NULL, (len > 0 ? len : 1) * sizeof(int));
+    int *ys = bigBrainRealloc(NULL, (len > 0 ? len : 1) * sizeof(int));
+    int *keys = bigBrainRealloc(NULL, (len > 0 ? len : 1) * sizeof(int));
+    if (csr == NULL || xs == NULL || ys == NULL || keys == NULL)
     {
-        printf("false\n");
-        return false;
+        errMsg("Allocation failed.\n", false);
+        return NULL;
     }
-
-    if ((areRelationMembersInSet(R, A, 1) && areRelationMembersInSet(R, B, 2)) && isRelDomainComplete(R, A))
+    csr->rowStart = bigBrainRealloc(NULL, (n + 1) * sizeof(int));
+    csr->colStart = bigBrainRealloc(NULL, (n + 1) * sizeof(int));
+    csr->succ = bigBrainRealloc(NULL, (len > 0 ? len : 1) * sizeof(int));
+    csr->pred = bigBrainRealloc(NULL, (len > 0 ? len : 1) * sizeof(int));
+    if (csr->rowStart == NULL || csr->colStart == NULL || csr->succ == NULL || csr->pred == NULL)
     {
-        for (int i = 0; i < B->set_len; i++)
-        {
-            bool status = false;
-            for (int j = 0; j < R->relation_len; j++)
-            {
-                if (B->items[i] == R->items[j].y)
-                {
-                    status = true;
-                }
-            }
-            if (!status)
-            {
-                printf("false\n");
-                return false;
-            }
-        }
-        return function(R);
+        errMsg("Allocation failed.\n", false);
+        return NULL;
     }
-    else
+
+    for (int i = 0; i < len; i++)
     {
-        printf("false\n");
-        return false;
+        xs[i] = R->items[i].x;
+        ys[i] = R->items[i].y;
     }
-}
 
-/// Prints true when the relation function is bijective and false otherwise
-/// \param R relation of the sets (A,B)
-/// \param A a set indicating the domain of a function
-/// \param B a set indicating the codomain of a function
-/// \return true when the relation is bijective, false otherwise
-bool bijective(relation_t *R, set_t *A, set_t *B)
-{
-    if ((areRelationMembersInSet(R, A, 1) && areRelationMembersInSet(R, B, 2)) && isRelDomainComplete(R, A))
+    // the first items grouped by the second one, in the order of the pairs
+    groupByKey(csr->colStart, csr->pred, ys, xs, len, n);
+
+    // visiting the groups by increasing second item sorts every successor list
+    for (int y = 0, k = 0; y < n; y++)
     {
-        if (A->set_len == B->set_len)
+        for (int i = csr->colStart[y]; i < csr->colStart[y + 1]; i++, k++)
         {
-            for (int i = 0; i < R->relation_len; i++)
-            {
-                for (int j = 0; j < R->relation_len; j++)
-                {
-                    if (R->items[i].y == R->items[j].y && R->items[i].x != R->items[j].x)
-                    {
-                        printf("false\n");
-                        return false;
-                    }
-                }
-            }
-            for (int i = 0; i < B->set_len; i++)
-            {
-                bool status = false;
-                for (int j = 0; j < R->relation_len; j++)
-                {
-                    if (B->items[i] == R->items[j].y)
-                    {
-                        status = true;
-                    }
-                }
-                if (!status)
-                {
-                    printf("false\n");
-                    return false;
-                }
-            }
-            return function(R);
+            keys[k] = csr->pred[i];
+            xs[k] = y;
         }
-        else
+    }
+    groupByKey(csr->rowStart, csr->succ, keys, xs, len, n);
+
+    // and visiting the successor lists by increasing first item sorts every predecessor list
+    for (int x = 0, k = 0; x < n; x++)
+    {
+        for (int i = csr->rowStart[x]; i < csr->rowStart[x + 1]; i++, k++)
         {
-            printf("false\n");
-            return false;
+            keys[k] = csr->succ[i];
+            xs[k] = x;
         }
     }
-    else
+    groupByKey(csr->colStart, csr->pred, keys, xs, len, n);
+
+    R->csr = csr;
+    return csr;
+}
+
+/// Checks whether a relation contains a pair, by a binary search in the successors of its first item
+/// \param csr adjacency index of the relation
+/// \param x the first item of the pair
+/// \param y the second item of the pair
+/// \return true when the pair belongs to the relation, false otherwise
+bool hasPair(relIndex_t *csr, int x, int y)
+{
+    int lo = csr->rowStart[x], hi = csr->rowStart[x + 1];
+    while (lo < hi)
     {
-        printf("false\n");
-        return false;
+        int mid = lo + (hi - lo) / 2;
+        if (csr->succ[mid] < y) lo = mid + 1;
+        else hi = mid;
     }
+    return lo < csr->rowStart[x + 1] && csr->succ[lo] == y;
 }
 
-/// Prints a reflexive closure of the relation
-/// \param relation a relation in which we want a reflexive closure
+/// Numbers the items a relation touches, in increasing order
+/// \param relation the relation
 /// \param universe the universe over which the relation is defined
-/// \param dest a relation where the result of the reflexive closure is stored
-/// \return false on failure of an allocation, true on success
-int closure_ref(relation_t *relation, universe_t *universe, relation_t *dest)
+/// \param nodes set to the touched items in increasing order
+/// \param node set to the number of every universe item, INVALID_INDEX for items the relation does not touch
+/// \return INVALID_INDEX on failure of an allocation, the number of touched items on success
+int touchedItems(relation_t *relation, universe_t *universe, int **nodes, int **node)
 {
-    relation_t tmp = {.items = NULL, .relation_len = relation->relation_len};
-    if (relation->relation_len != 0)
-    {
-        tmp.items = malloc(sizeof(relationUnit_t) * relation->relation_len);
-        if (tmp.items == NULL)
-            return errMsg("Allocation failed.\n", false);
+    int size = universe->universe_len > 0 ? universe->universe_len : 1;
+    *node = bigBrainRealloc(NULL, size * sizeof(int));
+    *nodes = bigBrainRealloc(NULL, size * sizeof(int));
+    if (*node == NULL || *nodes == NULL)
+        return errMsg("Allocation failed.\n", INVALID_INDEX);
 
-        memcpy (tmp.items, relation->items, sizeof(relationUnit_t) * relation->relation_len);
+    for (int i = 0; i < universe->universe_len; i++)
+    {
+        (*node)[i] = INVALID_INDEX;
     }
+    for (int i = 0; i < relation->relation_len; i++)
+    {
+        (*node)[relation->items[i].x] = (*node)[relation->items[i].y] = 0;
+    }
+    int nodeCount = 0;
     for (int i = 0; i < universe->universe_len; i++)
     {
-        relationUnit_t unit = {.x = i, .y = i};
-        if (containsRelationUnit(relation, &unit) < 0)
+        if ((*node)[i] != INVALID_INDEX)
         {
-            tmp.items = bigBrainRealloc(tmp.items, ++tmp.relation_len * sizeof(relationUnit_t));
-            if (tmp.items == NULL)
-            {
-                return errMsg("Allocation failed.\n", false);
-            }
-            tmp.items[tmp.relation_len - 1].x = unit.x;
-            tmp.items[tmp.relation_len - 1].y = unit.y;
+            (*nodes)[nodeCount] = i;
+            (*node)[i] = nodeCount++;
         }
     }
-    printRelation(&tmp, universe);
-    dest->items = tmp.items;
-    dest->relation_len = tmp.relation_len;
-    return true;
+    return nodeCount;
 }
 
-/// Prints a symmetric closure of the relation
-/// \param relation a relation in which we want a symmetric closure
-/// \param universe the universe over which the relation is defined
-/// \param dest a relation where the result of the symmetric closure is stored
-/// \return false on failure of an allocation, true on success
-int closure_sym(relation_t *relation, universe_t *universe, relation_t *dest)
+/// Decides whether a relation is worth a bit matrix over the items it touches \n
+/// k touched items cost the matrix k^2 bits and up to k^3 / 64 word operations whatever the relation looks
+/// like, the sparse algorithms walk successor lists and only pay off while those stay short
+/// \param relation the relation
+/// \param nodeCount number of items the relation touches
+/// \return true when the bit matrix should be used, false otherwise
+bool preferMatrix(relation_t *relation, int nodeCount)
 {
-    relation_t tmp = {.items = NULL, .relation_len = relation->relation_len};
-    if (relation->relation_len != 0)
-    {
-        tmp.items = malloc(sizeof(relationUnit_t) * relation->relation_len);
-        if (tmp.items == NULL)
-            return errMsg("Allocation failed.\n", false);
+    return nodeCount <= MATRIX_MAX_NODES && relation->relation_len >= MATRIX_MIN_DEGREE * nodeCount;
+}
 
-        memcpy (tmp.items, relation->items, sizeof(relationUnit_t) * relation->relation_len);
+/// Builds the bit matrix of a relation over the items it touches, row x has bit y set for the pair (x y)
+/// \param relation the relation
+/// \param nodeCount number of items the relation touches
+/// \param node number of every universe item as given by touchedItems
+/// \return NULL on failure of an allocation, the rows of (nodeCount + 63) / 64 words each on success
+uint64_t *relationMatrix(relation_t *relation, int nodeCount, int *node)
+{
+    size_t words = (nodeCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    size_t bytes = (nodeCount > 0 ? nodeCount * words : 1) * sizeof(uint64_t);
+    uint64_t *matrix = bigBrainRealloc(NULL, bytes);
+    if (matrix == NULL)
+    {
+        errMsg("Allocation failed.\n", false);
+        return NULL;
     }
+
+    memset(matrix, 0, bytes);
     for (int i = 0; i < relation->relation_len; i++)
     {
-        if (tmp.items[i].x != tmp.items[i].y)
-        {
-            relationUnit_t unit = {.x = tmp.items[i].y, .y = tmp.items[i].x};
-            if (containsRelationUnit(&tmp, &unit) < 0)
-            {
-                tmp.items = bigBrainRealloc(tmp.items, ++tmp.relation_len * sizeof(relationUnit_t));
-                if (tmp.items == NULL)
-                {
-                    return errMsg("Allocation failed.\n", false);
-                }
-                tmp.items[tmp.relation_len - 1].x = unit.x;
-                tmp.items[tmp.relation_len - 1].y = unit.y;
-            }
-        }
+        int col = node[relation->items[i].y];
+        matrix[node[relation->items[i].x] * words + col / BITS_PER_WORD] |= (uint64_t) 1 << (col % BITS_PER_WORD);
     }
-    printRelation(&tmp, universe);
-    dest->relation_len = tmp.relation_len;
-    dest->items = tmp.items;
-    return true;
+    return matrix;
 }
 
-/// Prints a transitive closure of the relation
-/// \param relation a relation in which we want a transitive closure
-/// \param universe the universe over which the relation is defined
-/// \param dest a relation where the result of the transitive  closure is stored
-/// \return false on failure of an allocation, true on success
-int closure_trans(relation_t *relation, universe_t *universe, relation_t *dest)
+/// Checks whether the composition of a relation with itself stays within the relation, row by row over its
+/// bit matrix \n
+/// The rows reached from row i are OR-ed together one block of MATRIX_BLOCK_WORDS words at a time, so the
+/// accumulator stays in registers and the first block leaving row i ends the check
+/// \param matrix the bit matrix of the relation
+/// \param nodeCount number of rows of the matrix
+/// \return true when R o R is a subset of R, false otherwise
+bool composesWithin(const uint64_t *matrix, int nodeCount)
 {
-    relation_t tmp = {.items = NULL, .relation_len = relation->relation_len};
-    if (relation->relation_len != 0)
-    {
-        tmp.items = malloc(sizeof(relationUnit_t) * relation->relation_len);
-        if (tmp.items == NULL)
-            return errMsg("Allocation failed.\n", false);
-
-        memcpy(tmp.items, relation->items, sizeof(relationUnit_t) * relation->relation_len);
-    }
-    for (int i = 0; i < tmp.relation_len; i++)
+    int words = (nodeCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    uint64_t acc[MATRIX_BLOCK_WORDS];
+    for (int i = 0; i < nodeCount; i++)
     {
-        for (int j = 0; j < tmp.relation_len; j++)
+        const uint64_t *row = &matrix[(size_t) i * words];
+        for (int from = 0; from < words; from += MATRIX_BLOCK_WORDS)
         {
-            if (tmp.items[i].y == tmp.items[j].x)
+            int to = from + MATRIX_BLOCK_WORDS < words ? from + MATRIX_BLOCK_WORDS : words;
+            memset(acc, 0, sizeof(acc));
+            for (int w = 0; w < words; w++)
             {
-                relationUnit_t unit = {.x = tmp.items[i].x, .y = tmp.items[j].y};
-                if (containsRelationUnit(&tmp, &unit) < 0)
+                for (uint64_t word = row[w]; word != 0; word &= word - 1)
                 {
-                    tmp.items = bigBrainRealloc(tmp.items, ++tmp.relation_len * sizeof(relationUnit_t));
-                    if (tmp.items == NULL)
+                    const uint64_t *through = &matrix[(size_t) (w * BITS_PER_WORD + lowestBit(word)) * words];
+                    for (int b = from; b < to; b++)
                     {
-                        return errMsg("Allocation failed.\n", false);
+                        acc[b - from] |= through[b];
                     }
-                    tmp.items[tmp.relation_len - 1].x = unit.x;
-                    tmp.items[tmp.relation_len - 1].y = unit.y;
                 }
             }
+            for (int b = from; b < to; b++)
+            {
+                if (acc[b - from] & ~row[b]) return false;
+            }
         }
     }
-    printRelation(&tmp, universe);
-    dest->items = tmp.items;
-    dest->relation_len = tmp.relation_len;
     return true;
 }
 
-/// Selects a random item from the set/relation and prints it to stdout
-/// \param rel the relation from which we choose the random item
-/// \param set the set from which we choose the random item
-/// \param universe the universe over which the relation/set are defined
-/// \param dest the set to which the resulting one-item set is stored
-/// \return true if an item is successfully printed, false if the argument passed is an empty relation or set
-int select_rand(relation_t *rel, set_t *set, universe_t *universe, set_t *dest)
+/// Prints true when the relation is reflexive and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation that is suspected of being reflexive
+/// \param out the output the result is written to
+/// \return true when the relation is reflexive, false otherwise
+bool reflexive(universe_t *uni, relation_t *R, output_t *out)
 {
-    dest->items = NULL;
-    dest->set_len = 0;
-    srand(time(0));
-    if (rel != NULL && rel->relation_len != 0 && set == NULL) // a relation was passed
-    {
-        int random = rand() % rel->relation_len;
-        printf("S %s\n", universe->items[rel->items[random].x]);
-
-        dest->items = bigBrainRealloc(dest->items, sizeof(int));
-        if (dest->items == NULL) return errMsg("Allocation failed.\n", false);
-
-        dest->items[0] = rel->items[random].x;
-        dest->set_len = 1;
-
-        return true;
-    }
-    else if (set != NULL && set->set_len != 0 && rel == NULL) // a set was passed
+    int reflexiveUnitsCount = 0;
+    for (int i = 0; i < R->relation_len; i++)
     {
-        int random = rand() % set->set_len;
-        printf("S %s\n", universe->items[set->items[random]]);
-
-        dest->items = bigBrainRealloc(dest->items, sizeof(int));
-        if (dest->items == NULL) return errMsg("Allocation failed.\n", false);
-
-        dest->items[0] = set->items[random];
-        dest->set_len = 1;
-
-        return true;
+        if (R->items[i].x == R->items[i].y)
+        {
+            reflexiveUnitsCount++;
+        }
     }
-    else // empty relation or empty set
+    if (reflexiveUnitsCount == uni->universe_len)
     {
-        return false;
+        outString(out, "true\n");
+        return true;
     }
+    outString(out, "false\n");
+    return false;
 }
 
-
-/// Finds a matching string in the list of functions
-/// \param command a string with a command
-/// \return an index of a function in a list if string was found, otherwise -1
-int matchStringToFunc(char *command)
+/// Prints true when the relation is symmetric and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation that is suspected of being symmetric
+/// \param out the output the result is written to
+/// \return true when the relation is symmetric, false otherwise
+bool symmetric(universe_t *uni, relation_t *R, output_t *out)
 {
-    for (int i = 0; i < COMBINED_FUNCTIONS_LASTINDEX; i++)
+    relIndex_t *csr = relationIndex(R, uni);
+    if (csr == NULL) return false;
+
+    for (int i = 0; i < R->relation_len; i++)
     {
-        if (strcmp(command, functions[i]) == 0)
+        if (!hasPair(csr, R->items[i].y, R->items[i].x))
         {
-            return i;
+            outString(out, "false\n");
+            return false;
         }
     }
-    return -1;
+    outString(out, "true\n");
+    return true;
 }
 
-/// Finds a set location in the setList or commandList if a command index is entered \n
-/// If an index of a command that hasn't been executed yet is entered a dummy empty set is made
-/// and a position of this set is stored into the empt variable
-/// \param sets list of all sets
-/// \param lineIdx index of a line where the set is located
-/// \param cmds a list of all commands
-/// \param empt a variable in which the index of a dummy empty set is saved
-/// \return an index line of a set in a list, otherwise INVALID_INDEX
-int findSet(setList_t *sets, int lineIdx, commandList_t *cmds, int *empt)
+/// Prints true when the relation is antisymmetric and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation that is suspected of being antisymmetric
+/// \param out the output the result is written to
+/// \return true when the relation is antisymmetric, false otherwise
+bool antisymmetric(universe_t *uni, relation_t *R, output_t *out)
 {
-    for (int i = 0; i < cmds->commandList_len; i++)
+    relIndex_t *csr = relationIndex(R, uni);
+    if (csr == NULL) return false;
+
+    for (int i = 0; i < R->relation_len; i++)
     {
-        if (cmds->commands[i].idx == lineIdx && *empt == 0 && !cmds->commands[i].exec)
-        {
-            set_t emptiness = {.items = NULL, .set_len = 0};
-            if (!insertToSetList(&emptiness, sets)) return false;
-            *empt = sets->setList_len-1;
-            return sets->setList_len-1;
-        }
-        else if (cmds->commands[i].idx == lineIdx && *empt != 0 && !cmds->commands[i].exec)
+        if (R->items[i].x != R->items[i].y && hasPair(csr, R->items[i].y, R->items[i].x))
         {
-            return *empt;
+            outString(out, "false\n");
+            return false;
         }
-        if (cmds->commands[i].idx == lineIdx && cmds->commands[i].exec)
-            break;
-    }
-    for (int i = 0; i < sets->setList_len; i++)
-    {
-        if (sets->sets[i].index == lineIdx) return i;
-        else if (sets->sets[i].index > lineIdx) return INVALID_INDEX;
     }
-    return INVALID_INDEX;
+    outString(out, "true\n");
+    return true;
 }
 
-/// Finds a relation location in the relationList or commandList if a command index is entered \n
-/// If an index of a command that hasn't been executed yet is entered a dummy empty relation is made
-/// and a position of this relation is stored into the empt variable
-/// \param relations list of all relations
-/// \param lineIdx index of a line where the relation is located
-/// \param cmds a list of all commands
-/// \param empt a variable in which the index of a dummy empty relation is saved
-/// \return an index line of a relation in a list, otherwise INVALID_INDEX
-int findRel(relationList_t *relations, int lineIdx, commandList_t *cmds, int *empt)
+/// Prints true when the relation is transitive and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation that is suspected of being transitive
+/// \param out the output the result is written to
+/// \return true when the relation is transitive, false otherwise
+bool transitive(universe_t *uni, relation_t *R, output_t *out)
 {
-    for (int i = 0; i < cmds->commandList_len; i++)
-    {
-        if (cmds->commands[i].idx == lineIdx && *empt == 0 && !cmds->commands[i].exec)
-        {
-            relation_t emptiness = {.items = NULL, .relation_len = 0};
-            if (!insertToRelatioList(&emptiness, relations)) return false;
-            *empt = relations->relationList_len-1;
-            return relations->relationList_len-1;
-        }
-        else if (cmds->commands[i].idx == lineIdx && *empt != 0 && !cmds->commands[i].exec)
-            return *empt;
-        if (cmds->commands[i].idx == lineIdx && cmds->commands[i].exec)
-            break;
-    }
-    for (int i = 0; i < relations->relationList_len; i++)
+    arena_t *scratch = ownArena();
+    arenaMark_t mark = arenaMark(scratch);
+    int *nodes, *node;
+    int nodeCount = touchedItems(R, uni, &nodes, &node);
+    if (nodeCount == INVALID_INDEX) return false;
+
+    // dense relations are tested as R o R being a subset of R over the bit matrix
+    if (preferMatrix(R, nodeCount))
     {
-        if (relations->relations[i].index == lineIdx) return i;
-        else if (relations->relations[i].index > lineIdx) return INVALID_INDEX;
-    }
-    return INVALID_INDEX;
-}
+        uint64_t *matrix = relationMatrix(R, nodeCount, node);
+        if (matrix == NULL) return false;
 
-/// Checks arguments of a command
-/// \param cmd a list of all commands
-/// \param sets a list of all sets
-/// \param relations a list of relations
-/// \param fileSize a count of all lines in a file
-/// \param bonus a variable deciding how many arguments are acceptable for the command
-/// \param cmds a list of all commands
-/// \param emptS a variable in which the index of a dummy empty set is saved
-/// \param emptR a variable in which the index of a dummy empty relation is saved
-/// \return true when the arguments are correct, false when any of the arguments is incorrect
-int checkArgs(command_t *cmd, setList_t *sets, relationList_t *relations, int fileSize, int *bonus, commandList_t *cmds, int *emptS, int *emptR)
-{
-    int arg_count[] = {1, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1,
-                       1, 1, 1, 1, 1, 1, 3, 3, 3, 1};
+        bool status = composesWithin(matrix, nodeCount);
+        arenaRollback(scratch, &mark);
+        outString(out, status ? "true\n" : "false\n");
+        return status;
+    }
+    // the numbering of the items is only needed by the matrix, the index below is kept with the relation
+    arenaRollback(scratch, &mark);
 
-    int arg_count_bonus[] = {2, 1, 1, 2, 2, 2, 3, 3, 3, 2, 2, 2, 2,
-                             2, 2, 2, 2, 1, 1, 4, 4, 4, 2};
-    int argc = cmd->argc;
+    relIndex_t *csr = relationIndex(R, uni);
+    if (csr == NULL) return false;
 
-    if (argc != arg_count[cmd->functionNameIdx])
-    {
-        if (argc != arg_count_bonus[cmd->functionNameIdx]) return false;
-        if (cmd->parameters[argc - 1] > fileSize || cmd->parameters[argc - 1] < 1) return false;
-        *bonus = 1;
-        argc--;
-    }
-    if (cmd->functionNameIdx >= 0 && cmd->functionNameIdx < SET_FUNCTIONS_LASTINDEX)
+    // every path x -> y -> z has to be shortcut by the pair (x z)
+    for (int i = 0; i < R->relation_len; i++)
     {
-        for (int j = 0; j < argc; j++)
+        int x = R->items[i].x, y = R->items[i].y;
+        for (int k = csr->rowStart[y]; k < csr->rowStart[y + 1]; k++)
         {
-            if (findSet(sets, cmd->parameters[j], cmds, emptS) == INVALID_INDEX)
+            if (!hasPair(csr, x, csr->succ[k]))
             {
+                outString(out, "false\n");
                 return false;
             }
         }
     }
-    else if (cmd->functionNameIdx >= SET_FUNCTIONS_LASTINDEX && cmd->functionNameIdx < REL_FUNCTIONS_LASTINDEX)
+    outString(out, "true\n");
+    return true;
+}
+
+/// Prints true when the relation is a function and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation that is suspected of being a function
+/// \param out the output the result is written to
+/// \return true when the relation is a function, false otherwise
+bool function(universe_t *uni, relation_t *R, output_t *out)
+{
+    relIndex_t *csr = relationIndex(R, uni);
+    if (csr == NULL) return false;
+
+    // the successor lists are sorted, so two different successors are always at the ends of the list
+    for (int x = 0; x < uni->universe_len; x++)
     {
-        for (int j = 0; j < argc; j++)
+        int first = csr->rowStart[x], end = csr->rowStart[x + 1];
+        if (end - first > 1 && csr->succ[first] != csr->succ[end - 1])
         {
-            if (findRel(relations, cmd->parameters[j], cmds, emptR) == INVALID_INDEX)
-            {
-                return false;
-            }
-        }
-    }
-    else if (cmd->functionNameIdx == COMBINED_FUNCTIONS_LASTINDEX - 1) // for select
-    {
-        if (findRel(relations, cmd->parameters[0], cmds, emptR) == INVALID_INDEX &&
-            findSet(sets, cmd->parameters[0], cmds, emptS) == INVALID_INDEX)
-            return false;
-    }
-    else if (cmd->functionNameIdx >= REL_FUNCTIONS_LASTINDEX)
-    {
-        if (findRel(relations, cmd->parameters[0], cmds, emptR) == INVALID_INDEX ||
-            findSet(sets, cmd->parameters[1], cmds, emptS) == INVALID_INDEX ||
-            findSet(sets, cmd->parameters[2], cmds, emptS) == INVALID_INDEX)
+            outString(out, "false\n");
             return false;
+        }
     }
-    else  return true;
 
+    outString(out, "true\n");
     return true;
 }
 
-/// Reads the arguments passed to a command and save them to the corresponding command_t parameters
-/// \param file the file to be read from
-/// \param command the commands whose arguments are read
-/// \return true if the reading is successful, false otherwise
-int readArgs(FILE *file, command_t *command)
+/// Prints out the domain of the relation
+/// \param uni the universe over which the relation is defined
+/// \param R relation where we search for its domain
+/// \param dest a set where the result of the domain is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+bool domain(universe_t *uni, relation_t *R, set_t *dest, output_t *out)
 {
-    char *str, *ptr;
-    int status;
-    do
+    dest->items = NULL;
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
+
+    // the result has at most one item per pair, its length is the number of distinct items taken
+    if (R->relation_len != 0)
     {
-        status = readStringFromFile(file, &str);
-        if (!status) return false;
+        dest->items = bigBrainRealloc(NULL, R->relation_len * sizeof(int));
+        if (dest->items == NULL)
+            return false;
+    }
+    int domainCount = 0;
 
-        if (status == END_OF_LINE && strlen(str) == 0)
-        {
-            free(str);
-            return true;
-        }
+    // the items already taken are marked in a bitmap, which is kept as the bitmap view of the result
+    int words = bitWords(uni);
+    dest->bits = bigBrainRealloc(NULL, (words > 0 ? words : 1) * sizeof(uint64_t));
+    if (dest->bits == NULL)
+        return false;
+    memset(dest->bits, 0, (words > 0 ? words : 1) * sizeof(uint64_t));
 
-        long digit = strtol(str, &ptr, 10);
-        if (ptr[0] != '\0')
+    outString(out, "S");
+    for (int i = 0; i < R->relation_len; i++)
+    {
+        int item = R->items[i].x;
+        if (!testBit(dest->bits, item))
         {
-            free(str);
-            return errMsg("Command taking wrong index\n", false);
+            dest->bits[item / BITS_PER_WORD] |= (uint64_t) 1 << (item % BITS_PER_WORD);
+            outItem(out, uni, item);
+            dest->items[domainCount] = item;
+            domainCount++;
         }
-        free(str);
-        command->parameters = bigBrainRealloc(command->parameters, ++command->argc * sizeof(int));
-        if (command->parameters == NULL) return errMsg("Allocation failed.\n", false);
-
-        command->parameters[command->argc - 1] = (int) digit;
-
-    } while (status != END_OF_LINE);
-
+    }
+    dest->set_len = domainCount;
+    outString(out, "\n");
     return true;
 }
 
-/// Reads a command definition from the specified file
-/// \param file the file to be read from
-/// \param commands the list of commands where the newly read command will be added
-/// \param lineIndex the line number on which the command is defined
-/// \return true if reading is successful, false otherwise
-int readCommands(FILE *file, commandList_t *commands, int lineIndex)
+/// Prints out the codomain of the relation
+/// \param uni the universe over which the relation is defined
+/// \param R relation where we search for its codomain
+/// \param dest a set where the result of the codomain is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+bool codomain(universe_t *uni, relation_t *R, set_t *dest, output_t *out)
 {
-    if (testSpace(file) != DELIM) return false;
-
-    char *command;
-    int status = readStringFromFile(file, &command);
-    if (!status) return false;
-
-    int funcIdx = matchStringToFunc(command);
+    dest->items = NULL;
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
 
-    if (status == END_OF_LINE || funcIdx == -1)
+    // the result has at most one item per pair, its length is the number of distinct items taken
+    if (R->relation_len != 0)
     {
-        free(command);
-        return errMsg("Invalid arguments passed to command\n", false);
+        dest->items = bigBrainRealloc(NULL, R->relation_len * sizeof(int));
+        if (dest->items == NULL)
+            return false;
     }
+    int domainCount = 0;
 
-    command_t cmd = {.functionNameIdx = funcIdx, .argc = 0, .parameters = NULL, .exec = false, .idx = 0, .morphed = false};
-    free(command);
+    // the items already taken are marked in a bitmap, which is kept as the bitmap view of the result
+    int words = bitWords(uni);
+    dest->bits = bigBrainRealloc(NULL, (words > 0 ? words : 1) * sizeof(uint64_t));
+    if (dest->bits == NULL)
+        return false;
+    memset(dest->bits, 0, (words > 0 ? words : 1) * sizeof(uint64_t));
 
-    if (readArgs(file, &cmd) && insertIntoCommandList(commands, &cmd, lineIndex))
-    {
-        return true;
-    }
-    else if (cmd.argc > 0)
+    outString(out, "S");
+    for (int i = 0; i < R->relation_len; i++)
     {
-        free(cmd.parameters);
-        return false;
+        int item = R->items[i].y;
+        if (!testBit(dest->bits, item))
+        {
+            dest->bits[item / BITS_PER_WORD] |= (uint64_t) 1 << (item % BITS_PER_WORD);
+            outItem(out, uni, item);
+            dest->items[domainCount] = item;
+            domainCount++;
+        }
     }
-
+    dest->set_len = domainCount;
+    outString(out, "\n");
     return true;
 }
 
-/// Frees all dynamically allocated memory of the universe
-/// \param universe the universe to be freed
-void freeUniverse(universe_t *universe)
+/// Prints the universe contents to stdout
+/// \param universe the universe to be printed
+/// \param out the output the result is written to
+void printUniverse(universe_t *universe, output_t *out)
 {
+    outString(out, "U");
     for (int i = 0; i < universe->universe_len; i++)
     {
-        free(universe->items[i]);
+        outItem(out, universe, i);
     }
-    free(universe->items);
+    outString(out, "\n");
 }
 
-/// Frees all dynamically allocated memory for sets
-/// \param sets the setList to be freed
-void freeSets(setList_t *sets)
+/// Prints set contents to stdout
+/// \param set the set to be printed
+/// \param universe the universe the set members belong to
+/// \param out the output the result is written to
+void printSet(set_t *set, universe_t *universe, output_t *out)
 {
-    if (sets->setList_len == 0)
-        return; // the list is empty, nothing to free
-
-    for (int i = 0; i < sets->setList_len; i++)
+    if (set->index == 1)
     {
-        if (sets->sets[i].set_len != 0)
+        outString(out, "U");
+        for (int i = 0; i < set->set_len; i++)
         {
-            free(sets->sets[i].items);
+            outItem(out, universe, set->items[i]);
         }
+        outString(out, "\n");
+        return;
+    }
+    outString(out, "S");
+    for (int i = 0; i < set->set_len; i++)
+    {
+        outItem(out, universe, set->items[i]);
     }
-    free(sets->sets);
+    outString(out, "\n");
 }
 
-/// Frees all dynamically allocated memory for relations
-/// \param relations the relationList to be freed
-void freeRelations(relationList_t *relations)
+/// Prints relation contents to stdout
+/// \param relation the relation to be printed
+/// \param universe the universe the relation members belong to
+/// \param out the output the result is written to
+void printRelation(relation_t *relation, universe_t *universe, output_t *out)
 {
-    if (relations->relationList_len == 0)
-        return; // the list is empty, nothing to free
+    outString(out, "R");
+    for (int i = 0; i < relation->relation_len; i++)
+    {
+        outPair(out, universe, &relation->items[i]);
+    }
+    outString(out, "\n");
+}
 
-    for (int i = 0; i < relations->relationList_len; i++)
+/// Prints all file contents to stdout
+/// \param universe list of all universe contents to be printed
+/// \param relations list of all relation contents to be printed
+/// \param sets list of all set contents to be printed
+/// \param out the output the result is written to
+void printFile(universe_t *universe, relationList_t *relations, setList_t *sets, output_t *out)
+{
+    printUniverse(universe, out);
+    int i = 0, j = 1;
+    while (i < relations->relationList_len && j < sets->setList_len)
     {
-        if (relations->relations[i].relation_len != 0)
+        if (relations->relations[i].index < sets->sets[j].index)
         {
-            free(relations->relations[i].items);
+            printRelation(&relations->relations[i], universe, out);
+            i++;
+        }
+        else
+        {
+            printSet(&sets->sets[j], universe, out);
+            j++;
         }
     }
-    free(relations->relations);
+    while (i < relations->relationList_len) printRelation(&relations->relations[i++], universe, out);
+    while (j < sets->setList_len) printSet(&sets->sets[j++], universe, out);
 }
 
-/// Frees all dynamically allocated memory for commands
-/// \param commands the commandList to be freed
-void freeCommands(commandList_t *commands)
+/// Finds out how a relation behaves as a function from the set A to the set B, with a single pass over the
+/// relation and over each of the sets \n
+/// For every universe item the counters hold the only item it is mapped to, the only item it is mapped from,
+/// and which of the sets it belongs to
+/// \param uni the universe over which the relation and the sets are defined
+/// \param R relation of the sets (A,B)
+/// \param A set indicating the domain of a function
+/// \param B set indicating the codomain of a function
+/// \param facts the properties to be filled
+/// \return false on failure of an allocation, true on success
+bool analyzeFunction(universe_t *uni, relation_t *R, set_t *A, set_t *B, functionFacts_t *facts)
 {
-    if (commands->commandList_len == 0) return;
+    int n = uni->universe_len > 0 ? uni->universe_len : 1;
+    int *counters = bigBrainRealloc(NULL, 3 * n * sizeof(int));
+    if (counters == NULL)
+        return errMsg("Allocation failed.\n", false);
 
-    for (int i = 0; i < commands->commandList_len; i++)
+    int *image = counters, *preimage = counters + n, *side = counters + 2 * n;
+    for (int i = 0; i < n; i++)
+    {
+        image[i] = preimage[i] = EMPTY_SLOT;
+        side[i] = 0;
+    }
+    for (int i = 0; i < A->set_len; i++)
+    {
+        side[A->items[i]] |= 1;
+    }
+    for (int i = 0; i < B->set_len; i++)
+    {
+        side[B->items[i]] |= 2;
+    }
+
+    facts->members = facts->total = facts->functional = facts->injective = facts->surjective = true;
+    for (int i = 0; i < R->relation_len; i++)
+    {
+        int x = R->items[i].x, y = R->items[i].y;
+        if (!(side[x] & 1) || !(side[y] & 2)) facts->members = false;
+
+        if (image[x] == EMPTY_SLOT) image[x] = y;
+        else if (image[x] != y) facts->functional = false;
+
+        if (preimage[y] == EMPTY_SLOT) preimage[y] = x;
+        else if (preimage[y] != x) facts->injective = false;
+    }
+    for (int i = 0; i < A->set_len; i++)
+    {
+        if (image[A->items[i]] == EMPTY_SLOT) facts->total = false;
+    }
+    for (int i = 0; i < B->set_len; i++)
     {
-        if (commands->commands[i].argc != 0) free(commands->commands[i].parameters);
+        if (preimage[B->items[i]] == EMPTY_SLOT) facts->surjective = false;
     }
-    free(commands->commands);
+
+    arenaFree(ownArena(), counters);
+    return true;
 }
 
-/// Frees all dynamically allocated memory in the program
-/// \param universe the universe to be freed
-/// \param relations the relationList to be freed
-/// \param sets the setList to be freed
-/// \param file the file to be closed
-void destructor(universe_t *universe, relationList_t *relations, setList_t *sets, FILE *file, commandList_t *commands)
+/// Prints true when the relation function is injective and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation of the sets (A,B)
+/// \param A set indicating the domain of a function
+/// \param B set indicating the codomain of a function
+/// \param out the output the result is written to
+/// \return true when the relation is injective, false otherwise
+bool injective(universe_t *uni, relation_t *R, set_t *A, set_t *B, output_t *out)
 {
-    freeUniverse(universe);
-    freeRelations(relations);
-    freeSets(sets);
-    freeCommands(commands);
-    fclose(file);
+    functionFacts_t facts;
+    if (!analyzeFunction(uni, R, A, B, &facts)) return false;
+
+    bool status = facts.members && facts.total && facts.functional && facts.injective;
+    outString(out, status ? "true\n" : "false\n");
+    return status;
 }
 
-/// Function encapsulating all functionality of the set calculator, everything important happens here
-/// \param cmds list containing all commands in the file
-/// \param sets list containing all sets in the file
-/// \param relations list containing all relations in the file
+/// Prints true when the relation function is surjective and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation of the sets (A,B)
+/// \param A set indicating the domain of a function
+/// \param B set indicating the codomain of a function
+/// \param out the output the result is written to
+/// \return true when the relation is surjective, false otherwise
+bool surjective(universe_t *uni, relation_t *R, set_t *A, set_t *B, output_t *out)
+{
+    functionFacts_t facts;
+    if (!analyzeFunction(uni, R, A, B, &facts)) return false;
+
+    // a codomain bigger than the domain is rejected up front, whatever the relation
+    bool status = A->set_len >= B->set_len && facts.members && facts.total && facts.functional && facts.surjective;
+    outString(out, status ? "true\n" : "false\n");
+    return status;
+}
+
+/// Prints true when the relation function is bijective and false otherwise
+/// \param uni the universe over which the relation is defined
+/// \param R relation of the sets (A,B)
+/// \param A a set indicating the domain of a function
+/// \param B a set indicating the codomain of a function
+/// \param out the output the result is written to
+/// \return true when the relation is bijective, false otherwise
+bool bijective(universe_t *uni, relation_t *R, set_t *A, set_t *B, output_t *out)
+{
+    functionFacts_t facts;
+    if (!analyzeFunction(uni, R, A, B, &facts)) return false;
+
+    bool status = A->set_len == B->set_len && facts.members && facts.total && facts.functional && facts.injective &&
+                  facts.surjective;
+    outString(out, status ? "true\n" : "false\n");
+    return status;
+}
+
+/// Prints a reflexive closure of the relation
+/// \param relation a relation in which we want a reflexive closure
+/// \param universe the universe over which the relation is defined
+/// \param dest a relation where the result of the reflexive closure is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+int closure_ref(relation_t *relation, universe_t *universe, relation_t *dest, output_t *out)
+{
+    relation_t tmp = {.items = NULL, .relation_len = relation->relation_len, .csr = NULL};
+
+    // at most one pair per universe item is added
+    if (relation->relation_len + universe->universe_len != 0)
+    {
+        tmp.items = bigBrainRealloc(NULL, sizeof(relationUnit_t) * (relation->relation_len + universe->universe_len));
+        if (tmp.items == NULL)
+            return errMsg("Allocation failed.\n", false);
+
+        if (relation->relation_len != 0)
+            memcpy(tmp.items, relation->items, sizeof(relationUnit_t) * relation->relation_len);
+    }
+    relIndex_t *csr = relationIndex(relation, universe);
+    if (csr == NULL)
+        return false;
+
+    for (int i = 0; i < universe->universe_len; i++)
+    {
+        if (!hasPair(csr, i, i))
+        {
+            tmp.relation_len++;
+            tmp.items[tmp.relation_len - 1].x = i;
+            tmp.items[tmp.relation_len - 1].y = i;
+        }
+    }
+    printRelation(&tmp, universe, out);
+    dest->items = tmp.items;
+    dest->relation_len = tmp.relation_len;
+    dest->csr = NULL;
+    return true;
+}
+
+/// Prints a symmetric closure of the relation
+/// \param relation a relation in which we want a symmetric closure
+/// \param universe the universe over which the relation is defined
+/// \param dest a relation where the result of the symmetric closure is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+int closure_sym(relation_t *relation, universe_t *universe, relation_t *dest, output_t *out)
+{
+    relation_t tmp = {.items = NULL, .relation_len = relation->relation_len, .csr = NULL};
+
+    // every pair adds at most its mirror image
+    if (relation->relation_len != 0)
+    {
+        tmp.items = bigBrainRealloc(NULL, sizeof(relationUnit_t) * 2 * relation->relation_len);
+        if (tmp.items == NULL)
+            return errMsg("Allocation failed.\n", false);
+
+        memcpy (tmp.items, relation->items, sizeof(relationUnit_t) * relation->relation_len);
+    }
+    relIndex_t *csr = relationIndex(relation, universe);
+    if (csr == NULL)
+        return false;
+
+    // the pairs are unique, so a mirror image can only collide with a pair of the original relation
+    for (int i = 0; i < relation->relation_len; i++)
+    {
+        if (tmp.items[i].x != tmp.items[i].y)
+        {
+            relationUnit_t unit = {.x = tmp.items[i].y, .y = tmp.items[i].x};
+            if (!hasPair(csr, unit.x, unit.y))
+            {
+                tmp.relation_len++;
+                tmp.items[tmp.relation_len - 1].x = unit.x;
+                tmp.items[tmp.relation_len - 1].y = unit.y;
+            }
+        }
+    }
+    printRelation(&tmp, universe, out);
+    dest->relation_len = tmp.relation_len;
+    dest->items = tmp.items;
+    dest->csr = NULL;
+    return true;
+}
+
+/// Adds the pairs of a transitive closure with Warshall's algorithm over a bit matrix \n
+/// Only the items the relation touches get a row, and whenever row i reaches item k the whole row k is
+/// OR-ed into it a word at a time, a plain loop the compiler vectorizes where the target has SIMD
+/// \param relation the relation whose closure is wanted
+/// \param universe the universe over which the relation is defined
+/// \param nodes the touched items in increasing order
+/// \param nodeCount number of touched items
+/// \param node row of every universe item, INVALID_INDEX for items the relation does not touch
+/// \param tmp copy of the relation, the missing pairs are appended to it in row-major order
+/// \param capacity number of pairs tmp has room for, updated on growth
+/// \return false on failure of an allocation, true on success
+int closureWarshall(relation_t *relation, universe_t *universe, int *nodes, int nodeCount, int *node, relation_t *tmp, int *capacity)
+{
+    int words = (nodeCount + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    relIndex_t *csr = relationIndex(relation, universe);
+    uint64_t *matrix = relationMatrix(relation, nodeCount, node);
+    if (csr == NULL || matrix == NULL)
+        return false;
+
+    for (int k = 0; k < nodeCount; k++)
+    {
+        const uint64_t *through = &matrix[(size_t) k * words];
+        for (int i = 0; i < nodeCount; i++)
+        {
+            uint64_t *row = &matrix[(size_t) i * words];
+            if (!testBit(row, k)) continue;
+            for (int w = 0; w < words; w++)
+            {
+                row[w] |= through[w];
+            }
+        }
+    }
+
+    // the rows follow the order of the items, so the bits come out sorted by the first and then the second item
+    for (int i = 0; i < nodeCount; i++)
+    {
+        const uint64_t *row = &matrix[(size_t) i * words];
+        for (int w = 0; w < words; w++)
+        {
+            for (uint64_t word = row[w]; word != 0; word &= word - 1)
+            {
+                int y = nodes[w * BITS_PER_WORD + lowestBit(word)];
+                if (hasPair(csr, nodes[i], y)) continue;
+
+                tmp->items = growArray(tmp->items, capacity, ++tmp->relation_len, sizeof(relationUnit_t));
+                if (tmp->items == NULL)
+                    return errMsg("Allocation failed.\n", false);
+                tmp->items[tmp->relation_len - 1].x = nodes[i];
+                tmp->items[tmp->relation_len - 1].y = y;
+            }
+        }
+    }
+    return true;
+}
+
+/// Adds the pairs of a transitive closure through the condensation of the relation, for sparse relations \n
+/// Tarjan's algorithm finds the strongly connected components sinks first, so the components reachable from
+/// a component are known once its successors are done, and all its items share that one successor list
+/// \param relation the relation whose closure is wanted
+/// \param universe the universe over which the relation is defined
+/// \param nodes the touched items in increasing order
+/// \param nodeCount number of touched items
+/// \param node row of every universe item, INVALID_INDEX for items the relation does not touch
+/// \param tmp copy of the relation, the missing pairs are appended to it in row-major order
+/// \param capacity number of pairs tmp has room for, updated on growth
+/// \return false on failure of an allocation, true on success
+int closureCondensed(relation_t *relation, universe_t *universe, int *nodes, int nodeCount, int *node, relation_t *tmp, int *capacity)
+{
+    relIndex_t *csr = relationIndex(relation, universe);
+    size_t bytes = (nodeCount > 0 ? nodeCount : 1) * sizeof(int);
+    int *order = bigBrainRealloc(NULL, bytes), *low = bigBrainRealloc(NULL, bytes);
+    int *comp = bigBrainRealloc(NULL, bytes), *stack = bigBrainRealloc(NULL, bytes);
+    int *calls = bigBrainRealloc(NULL, bytes), *edge = bigBrainRealloc(NULL, bytes);
+    int *members = bigBrainRealloc(NULL, bytes), *memberStart = bigBrainRealloc(NULL, bytes + sizeof(int));
+    if (csr == NULL || order == NULL || low == NULL || comp == NULL || stack == NULL || calls == NULL || edge == NULL ||
+        members == NULL || memberStart == NULL)
+        return errMsg("Allocation failed.\n", false);
+
+    for (int v = 0; v < nodeCount; v++)
+    {
+        order[v] = INVALID_INDEX;
+    }
+
+    // Tarjan's algorithm with an explicit call stack, edge[v] is the next successor of v to be visited
+    int visited = 0, stackLen = 0, compCount = 0, memberCount = 0;
+    for (int root = 0; root < nodeCount; root++)
+    {
+        if (order[root] != INVALID_INDEX) continue;
+
+        int depth = 0;
+        calls[depth++] = root;
+        order[root] = low[root] = visited++;
+        edge[root] = csr->rowStart[nodes[root]];
+        stack[stackLen++] = root;
+        comp[root] = INVALID_INDEX;
+        while (depth > 0)
+        {
+            int v = calls[depth - 1];
+            if (edge[v] < csr->rowStart[nodes[v] + 1])
+            {
+                int w = node[csr->succ[edge[v]++]];
+                if (order[w] == INVALID_INDEX)
+                {
+                    calls[depth++] = w;
+                    order[w] = low[w] = visited++;
+                    edge[w] = csr->rowStart[nodes[w]];
+                    stack[stackLen++] = w;
+                    comp[w] = INVALID_INDEX;
+                }
+                else if (comp[w] == INVALID_INDEX && order[w] < low[v])
+                {
+                    low[v] = order[w];
+                }
+                continue;
+            }
+
+            depth--;
+            if (depth > 0 && low[v] < low[calls[depth - 1]]) low[calls[depth - 1]] = low[v];
+            if (low[v] != order[v]) continue;
+
+            memberStart[compCount] = memberCount;
+            int w;
+            do
+            {
+                w = stack[--stackLen];
+                comp[w] = compCount;
+                members[memberCount++] = nodes[w];
+            } while (w != v);
+            compCount++;
+        }
+    }
+    memberStart[compCount] = memberCount;
+
+    // the items reachable from every component, a component reaches itself only through a cycle
+    int **reach = bigBrainRealloc(NULL, (compCount > 0 ? compCount : 1) * sizeof(int *));
+    int *reachLen = bigBrainRealloc(NULL, (compCount > 0 ? compCount : 1) * sizeof(int));
+    int *stamp = bigBrainRealloc(NULL, (compCount > 0 ? compCount : 1) * sizeof(int));
+    int *found = NULL, foundCapacity = 0;
+    if (reach == NULL || reachLen == NULL || stamp == NULL)
+        return errMsg("Allocation failed.\n", false);
+
+    for (int c = 0; c < compCount; c++)
+    {
+        stamp[c] = INVALID_INDEX;
+    }
+    for (int c = 0; c < compCount; c++)
+    {
+        int len = 0;
+        for (int m = memberStart[c]; m < memberStart[c + 1]; m++)
+        {
+            for (int k = csr->rowStart[members[m]]; k < csr->rowStart[members[m] + 1]; k++)
+            {
+                int d = comp[node[csr->succ[k]]];
+                if (stamp[d] == c) continue;
+
+                // the successor component with everything it reaches, components come out sinks first
+                int add = memberStart[d + 1] - memberStart[d] + (d != c ? reachLen[d] : 0);
+                if ((found = growArray(found, &foundCapacity, len + add, sizeof(int))) == NULL)
+                    return errMsg("Allocation failed.\n", false);
+
+                stamp[d] = c;
+                for (int i = memberStart[d]; i < memberStart[d + 1]; i++)
+                {
+                    found[len++] = members[i];
+                }
+                if (d == c) continue;
+                for (int i = 0; i < reachLen[d]; i++)
+                {
+                    int e = comp[node[reach[d][i]]];
+                    if (stamp[e] == c) continue;
+
+                    // reach[d] is made of whole components, the first item met brings in all of its component
+                    stamp[e] = c;
+                    for (int j = memberStart[e]; j < memberStart[e + 1]; j++)
+                    {
+                        found[len++] = members[j];
+                    }
+                }
+            }
+        }
+
+        reachLen[c] = len;
+        reach[c] = NULL;
+        if (len == 0) continue;
+
+        if ((reach[c] = bigBrainRealloc(NULL, len * sizeof(int))) == NULL)
+            return errMsg("Allocation failed.\n", false);
+        memcpy(reach[c], found, len * sizeof(int));
+        qsort(reach[c], len, sizeof(int), compareInts);
+    }
+
+    // the items are visited in increasing order and every list is sorted, so the pairs come out row-major
+    for (int v = 0; v < nodeCount; v++)
+    {
+        int c = comp[v];
+        for (int i = 0; i < reachLen[c]; i++)
+        {
+            if (hasPair(csr, nodes[v], reach[c][i])) continue;
+
+            tmp->items = growArray(tmp->items, capacity, ++tmp->relation_len, sizeof(relationUnit_t));
+            if (tmp->items == NULL)
+                return errMsg("Allocation failed.\n", false);
+            tmp->items[tmp->relation_len - 1].x = nodes[v];
+            tmp->items[tmp->relation_len - 1].y = reach[c][i];
+        }
+    }
+    return true;
+}
+
+/// Puts the pairs added by a transitive closure into the order the pair loop finds them \n
+/// The pair loop takes every pair (a, b) in turn, the added ones included, and appends (a, c) for every pair (b, c)
+/// in its order that a is still missing. The closure is already known, so a row stops being extended once it is
+/// complete, and with the bit matrix a row of b bringing a nothing new is skipped a word at a time
+/// \param tmp the relation followed by the added pairs
+/// \param original number of pairs of the relation
+/// \param nodes the touched items in increasing order
+/// \param nodeCount number of touched items
+/// \param node row of every universe item, INVALID_INDEX for items the relation does not touch
+/// \return false on failure of an allocation, true on success
+int discoveryOrder(relation_t *tmp, int original, int *nodes, int nodeCount, int *node)
+{
+    int len = tmp->relation_len;
+    if (len == original) return true;
+
+    // the found pairs are a bit matrix over the touched items, or a hash set when the matrix would be too big
+    bool matrix = nodeCount <= MATRIX_MAX_NODES;
+    int words = (nodeCount + BITS_PER_WORD - 1) / BITS_PER_WORD, size = INIT_TABLE_SIZE;
+    while (!matrix && size < 2 * len) size *= 2;
+
+    relationUnit_t *order = bigBrainRealloc(NULL, len * sizeof(relationUnit_t));
+    int *listed = bigBrainRealloc(NULL, len * sizeof(int)), *rowStart = bigBrainRealloc(NULL, (nodeCount + 1) * sizeof(int));
+    int *listedLen = bigBrainRealloc(NULL, nodeCount * sizeof(int)), *missing = bigBrainRealloc(NULL, nodeCount * sizeof(int));
+    uint64_t *bits = matrix ? bigBrainRealloc(NULL, (size_t) nodeCount * words * sizeof(uint64_t)) : NULL;
+    pairSlot_t *pairs = matrix ? NULL : bigBrainRealloc(NULL, size * sizeof(pairSlot_t));
+    if (order == NULL || listed == NULL || rowStart == NULL || listedLen == NULL || missing == NULL ||
+        (matrix ? bits == NULL : pairs == NULL))
+        return errMsg("Allocation failed.\n", false);
+
+    memset(rowStart, 0, (nodeCount + 1) * sizeof(int));
+    memset(listedLen, 0, nodeCount * sizeof(int));
+    memset(missing, 0, nodeCount * sizeof(int));
+    if (matrix) memset(bits, 0, (size_t) nodeCount * words * sizeof(uint64_t));
+    else memset(pairs, 0, size * sizeof(pairSlot_t));
+
+    // every row lists the second items of its pairs in the order they are found
+    for (int p = 0; p < len; p++)
+    {
+        rowStart[node[tmp->items[p].x] + 1]++;
+        if (p >= original) missing[node[tmp->items[p].x]]++;
+    }
+    for (int a = 0; a < nodeCount; a++)
+    {
+        rowStart[a + 1] += rowStart[a];
+    }
+
+    // the pairs of the relation are found first
+    for (int r = 0; r < original; r++)
+    {
+        int a = node[tmp->items[r].x], c = node[tmp->items[r].y];
+        order[r] = tmp->items[r];
+        listed[rowStart[a] + listedLen[a]++] = c;
+        if (matrix) bits[(size_t) a * words + c / BITS_PER_WORD] |= (uint64_t) 1 << (c % BITS_PER_WORD);
+        else placePair(pairs, size, (uint64_t) a << 32 | (uint32_t) c, 1);
+    }
+
+    int count = original;
+    for (int i = 0; i < count; i++)
+    {
+        int a = node[order[i].x], b = node[order[i].y];
+        if (a == b || missing[a] == 0) continue;
+
+        if (matrix && listedLen[b] > words)
+        {
+            const uint64_t *rowA = &bits[(size_t) a * words], *rowB = &bits[(size_t) b * words];
+            uint64_t news = 0;
+            for (int w = 0; w < words; w++)
+            {
+                news |= rowB[w] & ~rowA[w];
+            }
+            if (news == 0) continue;
+        }
+
+        // the row of b does not grow while the row of a does
+        for (int k = 0; k < listedLen[b] && missing[a] > 0; k++)
+        {
+            int c = listed[rowStart[b] + k];
+            if (matrix)
+            {
+                uint64_t *word = &bits[(size_t) a * words + c / BITS_PER_WORD], bit = (uint64_t) 1 << (c % BITS_PER_WORD);
+                if (*word & bit) continue;
+                *word |= bit;
+            }
+            else if (!placePair(pairs, size, (uint64_t) a << 32 | (uint32_t) c, 1)) continue;
+
+            order[count].x = nodes[a];
+            order[count++].y = nodes[c];
+            listed[rowStart[a] + listedLen[a]++] = c;
+            missing[a]--;
+        }
+    }
+
+    memcpy(tmp->items + original, order + original, (len - original) * sizeof(relationUnit_t));
+    return true;
+}
+
+/// Prints a transitive closure of the relation, the pairs of the relation come first followed by the added pairs
+/// in the order the pair loop finds them, whichever algorithm computed them \n
+/// Relations touching at most MATRIX_MAX_NODES items with MATRIX_MIN_DEGREE pairs per item on average use
+/// the bit matrix, sparser or bigger ones the condensation
+/// \param relation a relation in which we want a transitive closure
+/// \param universe the universe over which the relation is defined
+/// \param dest a relation where the result of the transitive  closure is stored
+/// \param out the output the result is written to
+/// \return false on failure of an allocation, true on success
+int closure_trans(relation_t *relation, universe_t *universe, relation_t *dest, output_t *out)
+{
+    relation_t tmp = {.items = NULL, .relation_len = relation->relation_len, .csr = NULL};
+    int capacity = 0;
+    if (relation->relation_len != 0)
+    {
+        // the index is kept with the relation, so it is built before the memory of the computation is marked
+        if (relationIndex(relation, universe) == NULL)
+            return false;
+
+        arena_t *scratch = ownArena();
+        arenaMark_t mark = arenaMark(scratch);
+        tmp.items = growArray(NULL, &capacity, relation->relation_len, sizeof(relationUnit_t));
+        if (tmp.items == NULL)
+            return errMsg("Allocation failed.\n", false);
+
+        memcpy(tmp.items, relation->items, sizeof(relationUnit_t) * relation->relation_len);
+
+        int *nodes, *node;
+        int nodeCount = touchedItems(relation, universe, &nodes, &node);
+        if (nodeCount == INVALID_INDEX)
+            return false;
+
+        int status;
+        if (preferMatrix(relation, nodeCount))
+            status = closureWarshall(relation, universe, nodes, nodeCount, node, &tmp, &capacity);
+        else
+            status = closureCondensed(relation, universe, nodes, nodeCount, node, &tmp, &capacity);
+        if (!status || !discoveryOrder(&tmp, relation->relation_len, nodes, nodeCount, node))
+            return false;
+
+        // only the pairs outlive the computation, the numbering and the tables of the algorithms are released
+        tmp.items = arenaKeep(scratch, &mark, tmp.items, sizeof(relationUnit_t) * tmp.relation_len);
+        if (tmp.items == NULL)
+            return errMsg("Allocation failed.\n", false);
+    }
+    printRelation(&tmp, universe, out);
+    dest->items = tmp.items;
+    dest->relation_len = tmp.relation_len;
+    dest->csr = NULL;
+    return true;
+}
+
+/// Selects a random item from the set/relation and prints it to stdout
+/// \param rel the relation from which we choose the random item
+/// \param set the set from which we choose the random item
+/// \param universe the universe over which the relation/set are defined
+/// \param dest the set to which the resulting one-item set is stored
+/// \param out the output the result is written to
+/// \return true if an item is successfully printed, false if the argument passed is an empty relation or set
+int select_rand(relation_t *rel, set_t *set, universe_t *universe, set_t *dest, output_t *out)
+{
+    dest->items = NULL;
+    dest->bits = NULL;
+    dest->sorted = NULL;
+    dest->chunks = NULL;
+    dest->set_len = 0;
+    srand(time(0));
+    if (rel != NULL && rel->relation_len != 0 && set == NULL) // a relation was passed
+    {
+        int random = rand() % rel->relation_len;
+        outString(out, "S");
+        outItem(out, universe, rel->items[random].x);
+        outString(out, "\n");
+
+        dest->items = bigBrainRealloc(dest->items, sizeof(int));
+        if (dest->items == NULL) return errMsg("Allocation failed.\n", false);
+
+        dest->items[0] = rel->items[random].x;
+        dest->set_len = 1;
+
+        return true;
+    }
+    else if (set != NULL && set->set_len != 0 && rel == NULL) // a set was passed
+    {
+        int random = rand() % set->set_len;
+        outString(out, "S");
+        outItem(out, universe, set->items[random]);
+        outString(out, "\n");
+
+        dest->items = bigBrainRealloc(dest->items, sizeof(int));
+        if (dest->items == NULL) return errMsg("Allocation failed.\n", false);
+
+        dest->items[0] = set->items[random];
+        dest->set_len = 1;
+
+        return true;
+    }
+    else // empty relation or empty set
+    {
+        return false;
+    }
+}
+
+
+/// Finds a matching string in the list of functions
+/// \param command a string with a command
+/// \return an index of a function in a list if string was found, otherwise -1
+int matchStringToFunc(token_t *command)
+{
+    const keyword_t *keyword = findKeyword(command->str, command->len);
+    return keyword != NULL ? keyword->funcIdx : -1;
+}
+
+/// Records that an object of a list holds a line
+/// \param table positions of the objects by line
+/// \param hidden hidden flags of the objects by line
+/// \param max biggest line stored in the list so far, updated
+/// \param line the line the object holds
+/// \param pos position of the object in its list
+void noteLine(int *table, bool *hidden, long *max, long line, int pos)
+{
+    if (line >= 0 && line < LINE_SLOTS && table[line] == EMPTY_SLOT)
+    {
+        table[line] = pos;
+        hidden[line] = *max > line;
+    }
+    if (line > *max) *max = line;
+}
+
+/// Resolves every line of a parsed file to its command, set or relation
+/// \param lines the table to be filled
+/// \param cmds a list of all commands
+/// \param sets list of all sets
+/// \param relations list of all relations
+void buildLineTable(lineTable_t *lines, commandList_t *cmds, setList_t *sets, relationList_t *relations)
+{
+    for (int i = 0; i < LINE_SLOTS; i++)
+    {
+        lines->command[i] = lines->set[i] = lines->relation[i] = EMPTY_SLOT;
+        lines->setHidden[i] = lines->relationHidden[i] = false;
+    }
+    lines->setMax = lines->relationMax = 0;
+
+    for (int i = cmds->commandList_len - 1; i >= 0; i--)
+    {
+        if (cmds->commands[i].idx >= 0 && cmds->commands[i].idx < LINE_SLOTS) lines->command[cmds->commands[i].idx] = i;
+    }
+    for (int i = 0; i < sets->setList_len; i++)
+    {
+        noteLine(lines->set, lines->setHidden, &lines->setMax, sets->sets[i].index, i);
+    }
+    for (int i = 0; i < relations->relationList_len; i++)
+    {
+        noteLine(lines->relation, lines->relationHidden, &lines->relationMax, relations->relations[i].index, i);
+    }
+}
+
+/// Assigns a line to the set last added to the list
+/// \param lines the line table
+/// \param sets list of all sets
+/// \param line the line the set holds
+void bindSetLine(lineTable_t *lines, setList_t *sets, long line)
+{
+    sets->sets[sets->setList_len - 1].index = line;
+    noteLine(lines->set, lines->setHidden, &lines->setMax, line, sets->setList_len - 1);
+}
+
+/// Assigns a line to the relation last added to the list
+/// \param lines the line table
+/// \param relations list of all relations
+/// \param line the line the relation holds
+void bindRelationLine(lineTable_t *lines, relationList_t *relations, long line)
+{
+    relations->relations[relations->relationList_len - 1].index = line;
+    noteLine(lines->relation, lines->relationHidden, &lines->relationMax, line, relations->relationList_len - 1);
+}
+
+/// Finds a set location in the setList or commandList if a command index is entered \n
+/// If an index of a command that hasn't been executed yet is entered a dummy empty set is made
+/// and a position of this set is stored into the empt variable
+/// \param sets list of all sets
+/// \param lineIdx index of a line where the set is located
+/// \param cmds a list of all commands
+/// \param lines the line table
+/// \param empt a variable in which the index of a dummy empty set is saved
+/// \return an index line of a set in a list, otherwise INVALID_INDEX
+int findSet(setList_t *sets, int lineIdx, commandList_t *cmds, lineTable_t *lines, int *empt)
+{
+    if (lineIdx < 0 || lineIdx >= LINE_SLOTS) return INVALID_INDEX;
+
+    int command = lines->command[lineIdx];
+    if (command != EMPTY_SLOT && !cmds->commands[command].exec)
+    {
+        if (*empt != 0) return *empt;
+
+        set_t emptiness = {.items = NULL, .set_len = 0, .bits = NULL, .sorted = NULL, .chunks = NULL};
+        if (!insertToSetList(&emptiness, sets)) return false;
+        *empt = sets->setList_len-1;
+        return sets->setList_len-1;
+    }
+
+    if (lines->set[lineIdx] == EMPTY_SLOT || lines->setHidden[lineIdx]) return INVALID_INDEX;
+    return lines->set[lineIdx];
+}
+
+/// Finds a relation location in the relationList or commandList if a command index is entered \n
+/// If an index of a command that hasn't been executed yet is entered a dummy empty relation is made
+/// and a position of this relation is stored into the empt variable
+/// \param relations list of all relations
+/// \param lineIdx index of a line where the relation is located
+/// \param cmds a list of all commands
+/// \param lines the line table
+/// \param empt a variable in which the index of a dummy empty relation is saved
+/// \return an index line of a relation in a list, otherwise INVALID_INDEX
+int findRel(relationList_t *relations, int lineIdx, commandList_t *cmds, lineTable_t *lines, int *empt)
+{
+    if (lineIdx < 0 || lineIdx >= LINE_SLOTS) return INVALID_INDEX;
+
+    int command = lines->command[lineIdx];
+    if (command != EMPTY_SLOT && !cmds->commands[command].exec)
+    {
+        if (*empt != 0) return *empt;
+
+        relation_t emptiness = {.items = NULL, .relation_len = 0, .csr = NULL};
+        if (!insertToRelatioList(&emptiness, relations)) return false;
+        *empt = relations->relationList_len-1;
+        return relations->relationList_len-1;
+    }
+
+    if (lines->relation[lineIdx] == EMPTY_SLOT || lines->relationHidden[lineIdx]) return INVALID_INDEX;
+    return lines->relation[lineIdx];
+}
+
+/// Reads the arguments passed to a command and save them to the corresponding command_t parameters
+/// \param input the input buffer to be read from
+/// \param command the commands whose arguments are read
+/// \return true if the reading is successful, false otherwise
+int readArgs(input_t *input, command_t *command)
+{
+    token_t token;
+    char *ptr;
+    int status, capacity = 0;
+    do
+    {
+        status = readToken(input, &token);
+        if (!status) return false;
+
+        if (status == END_OF_LINE && token.len == 0)
+        {
+            return true;
+        }
+
+        // the token is followed by a delimiter, a newline or the terminating '\0' of the input
+        long digit = strtol(token.str, &ptr, 10);
+        if (ptr != token.str + token.len)
+        {
+            return errMsg("Command taking wrong index\n", false);
+        }
+        command->parameters = growArray(command->parameters, &capacity, ++command->argc, sizeof(int));
+        if (command->parameters == NULL) return errMsg("Allocation failed.\n", false);
+
+        command->parameters[command->argc - 1] = (int) digit;
+
+    } while (status != END_OF_LINE);
+
+    return true;
+}
+
+/// Reads a command definition from the specified file
+/// \param input the input buffer to be read from
+/// \param commands the list of commands where the newly read command will be added
+/// \param lineIndex the line number on which the command is defined
+/// \return true if reading is successful, false otherwise
+int readCommands(input_t *input, commandList_t *commands, int lineIndex)
+{
+    if (testSpace(input) != DELIM) return false;
+
+    token_t command;
+    int status = readToken(input, &command);
+    if (!status) return false;
+
+    int funcIdx = matchStringToFunc(&command);
+
+    if (status == END_OF_LINE || funcIdx == -1)
+    {
+        return errMsg("Invalid arguments passed to command\n", false);
+    }
+
+    command_t cmd = {.functionNameIdx = funcIdx, .argc = 0, .parameters = NULL, .exec = false, .idx = 0, .morphed = false};
+
+    if (readArgs(input, &cmd) && insertIntoCommandList(commands, &cmd, lineIndex))
+    {
+        return true;
+    }
+    else if (cmd.argc > 0) return false;
+
+    return true;
+}
+
+/// Tells which list an operand of a command is looked up in
+/// \param op the function of the command
+/// \param k position of the operand
+/// \return true for a relation, false for a set
+bool operandIsRelation(int op, int k)
+{
+    if (op < SET_FUNCTIONS_LASTINDEX) return false;
+    if (op < REL_FUNCTIONS_LASTINDEX) return true;
+    return k == 0;
+}
+
+/// Decides the kind of object a function makes
+/// \param op the function of a command
+/// \param relation true for the functions making a relation, false for those making a set
+/// \return true when the function makes an object of that kind, false otherwise
+bool makesObject(int op, bool relation)
+{
+    if (relation) return op >= 16 && op <= 18;
+    return (op >= 2 && op <= 5) || op == 14 || op == 15;
+}
+
+/// Builds the lookup structures the operators build on first use of a set or relation, so commands running at
+/// the same time only ever read the operands they share, and memory given back after a command keeps them
+/// \param object the set or relation
+/// \param relation the object is a relation
 /// \param universe the universe over which is everything defined
+/// \return true on success, false on failure of an allocation
+int prepareOperand(void *object, bool relation, universe_t *universe)
+{
+    if (relation) return relationIndex(object, universe) != NULL;
+
+    set_t *set = object;
+    if (setBackend == BACKEND_BITMAP) return setBits(set, universe) != NULL;
+    if (setBackend == BACKEND_ADAPTIVE) return setChunks(set, universe) != NULL;
+    return setSorted(set) != NULL || set->set_len == 0;
+}
+
+/// Compiles a command into an instruction, the argument counts and the operands naming definition lines are
+/// checked here once, operands naming command lines depend on what has run and are resolved when the command runs
+/// \param cmd the command
+/// \param ins the instruction to be filled, OP_INVALID when the command can never run
+/// \param lines the line table
+/// \param fileSize a count of all lines in a file
+void compileCommand(command_t *cmd, instruction_t *ins, lineTable_t *lines, int fileSize)
+{
+    int arg_count[] = {1, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1,
+                       1, 1, 1, 1, 1, 1, 3, 3, 3, 1};
+
+    int arg_count_bonus[] = {2, 1, 1, 2, 2, 2, 3, 3, 3, 2, 2, 2, 2,
+                             2, 2, 2, 2, 1, 1, 4, 4, 4, 2};
+    int argc = cmd->argc, op = cmd->functionNameIdx;
+
+    ins->op = OP_INVALID;
+    ins->argc = 0;
+    ins->jump = EMPTY_SLOT;
+    if (op < 0 || op >= COMBINED_FUNCTIONS_LASTINDEX) return;
+
+    if (argc != arg_count[op])
+    {
+        if (argc != arg_count_bonus[op]) return;
+        if (cmd->parameters[argc - 1] > fileSize || cmd->parameters[argc - 1] < 1) return;
+
+        // the loop continues one line after the jump, lines are counted from one
+        ins->jump = cmd->parameters[argc - 1] - 1;
+        argc--;
+    }
+
+    for (int k = 0; k < argc; k++)
+    {
+        int line = cmd->parameters[k];
+        ins->operandLine[k] = line;
+        ins->operand[k] = EMPTY_SLOT;
+        if (line < 0 || line >= LINE_SLOTS) return;
+        if (lines->command[line] != EMPTY_SLOT) continue;
+
+        bool relation = operandIsRelation(op, k);
+        bool found = relation ? lines->relation[line] != EMPTY_SLOT && !lines->relationHidden[line]
+                              : lines->set[line] != EMPTY_SLOT && !lines->setHidden[line];
+
+        // select takes either a set or a relation
+        if (op == COMBINED_FUNCTIONS_LASTINDEX - 1)
+            found = lines->set[line] != EMPTY_SLOT || lines->relation[line] != EMPTY_SLOT;
+        if (!found) return;
+        ins->operand[k] = relation ? lines->relation[line] : lines->set[line];
+    }
+
+    ins->op = op;
+    ins->argc = op == COMBINED_FUNCTIONS_LASTINDEX - 1 ? 0 : argc;
+}
+
+/// Marks the commands whose result is only printed, no operand of any command names their line
+/// and no jump leads back over them, so nothing could ever read the result or print it again
+/// \param program the compiled program
+/// \return true on success, false on failure of an allocation
+int markLazy(program_t *program)
+{
+    bool *read = bigBrainRealloc(NULL, (program->len > 0 ? program->len : 1) * sizeof(bool));
+    if (read == NULL) return errMsg("Allocation failed.\n", false);
+    memset(read, 0, (program->len > 0 ? program->len : 1) * sizeof(bool));
+
+    for (int pc = 0; pc < program->len; pc++)
+    {
+        instruction_t *ins = &program->code[pc];
+        int argc = ins->op == COMBINED_FUNCTIONS_LASTINDEX - 1 ? 1 : ins->argc;
+        for (int k = 0; k < argc; k++)
+        {
+            if (ins->operand[k] == EMPTY_SLOT && ins->operandLine[k] >= 1 && ins->operandLine[k] <= program->len)
+                read[ins->operandLine[k] - 1] = true;
+        }
+    }
+
+    // the earliest instruction a jump at or after the line leads to, a line no jump leads back over runs at most once
+    int reach = program->len;
+    for (int pc = program->len - 1; pc >= 0; pc--)
+    {
+        instruction_t *ins = &program->code[pc];
+        if (ins->jump != EMPTY_SLOT && ins->jump < reach) reach = ins->jump;
+        ins->lazy = !read[pc] && reach > pc && (makesObject(ins->op, false) || makesObject(ins->op, true) ||
+                                                 ins->op == COMBINED_FUNCTIONS_LASTINDEX - 1);
+    }
+
+    arenaFree(&arena, read);
+    return true;
+}
+
+/// Compiles all lines of a file into a program, definition lines print their object when a jump leads to them
+/// \param program the program to be filled
+/// \param cmds a list of all commands
+/// \param lines the line table
 /// \param initSize the number of lines that are not command definitions
 /// \param fileSize the number of line in the entire file
-/// \return true if the commands are successfully executed, false if an error happens in the process
-int execute(commandList_t *cmds, setList_t *sets, relationList_t *relations, universe_t *universe, int initSize, int fileSize)
+/// \return false on failure of an allocation, true on success
+int compileProgram(program_t *program, commandList_t *cmds, lineTable_t *lines, int initSize, int fileSize)
+{
+    program->code = bigBrainRealloc(NULL, (fileSize > 0 ? fileSize : 1) * sizeof(instruction_t));
+    if (program->code == NULL)
+        return errMsg("Allocation failed.\n", false);
+    program->len = fileSize;
+    program->start = initSize + 1;
+
+    for (int i = 0; i < fileSize; i++)
+    {
+        instruction_t *ins = &program->code[i];
+        int line = i + 1;
+        ins->lazy = false;
+        ins->command = line < LINE_SLOTS ? lines->command[line] : EMPTY_SLOT;
+        if (ins->command != EMPTY_SLOT)
+        {
+            compileCommand(&cmds->commands[ins->command], ins, lines, fileSize);
+            continue;
+        }
+
+        ins->argc = 0;
+        ins->jump = EMPTY_SLOT;
+        ins->op = OP_INVALID;
+        if (line < LINE_SLOTS && lines->set[line] != EMPTY_SLOT)
+        {
+            ins->op = OP_PRINT_SET;
+            ins->operand[0] = lines->set[line];
+        }
+        else if (line < LINE_SLOTS && lines->relation[line] != EMPTY_SLOT)
+        {
+            ins->op = OP_PRINT_RELATION;
+            ins->operand[0] = lines->relation[line];
+        }
+    }
+    return !lazyEvaluation || markLazy(program);
+}
+
+/// Fills the key of a command from its function and the item sequences of its resolved operands,
+/// interned sets and relations share their items, so equal operands are found by the address of the items
+/// \param key the entry the key is written to
+/// \param ins the instruction of the command
+/// \param pos the positions of the operands
+/// \param sets a list of all sets
+/// \param relations a list of relations
+void memoKey(memoEntry_t *key, instruction_t *ins, int *pos, setList_t *sets, relationList_t *relations)
 {
-    int hasBonus = 0;
-    initSize++; //to better represent the line on which the commands start
-    int cmd, emptS = 0, emptR = 0;
+    key->op = ins->op;
+    key->hash = hashPair((uint64_t) ins->op);
+    for (int k = 0; k < MAX_OPERANDS; k++)
+    {
+        key->operand[k] = NULL;
+        key->operandLen[k] = 0;
+        if (k < ins->argc && operandIsRelation(ins->op, k))
+        {
+            key->operand[k] = relations->relations[pos[k]].items;
+            key->operandLen[k] = relations->relations[pos[k]].relation_len;
+        }
+        else if (k < ins->argc)
+        {
+            key->operand[k] = sets->sets[pos[k]].items;
+            key->operandLen[k] = sets->sets[pos[k]].set_len;
+        }
 
-    for (int i = initSize; i < fileSize; i++)
+        // every empty operand is the same, wherever its items point
+        if (key->operandLen[k] == 0) key->operand[k] = NULL;
+        key->hash = hashPair(key->hash ^ (uint64_t) (uintptr_t) key->operand[k]) ^ (uint64_t) key->operandLen[k];
+    }
+}
+
+/// Looks a command up among the commands run before
+/// \param memo the memo table
+/// \param key the key of the command
+/// \return the entry of the same command on the same operands, NULL when there is none
+memoEntry_t *recall(memoTable_t *memo, memoEntry_t *key)
+{
+    if (memo->entries != NULL)
     {
-        hasBonus = 0;
-        if (i < initSize)
+        for (unsigned slot = key->hash & (memo->size - 1); memo->entries[slot].op != EMPTY_SLOT;
+             slot = (slot + 1) & (memo->size - 1))
         {
-            bool printed = false;
-            for(int o = 0; o < sets->setList_len && !printed; o++)
-            {
-                if (i == sets->sets[o].index-1)
-                {
-                    printSet(&sets->sets[o], universe);
-                    printed = true;
-                }
-            }
-            for(int o = 0; o < relations->relationList_len && !printed; o++)
-            {
-                if (i == relations->relations[o].index-1)
-                {
-                    printRelation(&relations->relations[o], universe);
-                    printed = true;
-                }
-            }
-            if (printed) continue;
+            memoEntry_t *entry = &memo->entries[slot];
+            if (entry->hash != key->hash || entry->op != key->op ||
+                memcmp(entry->operand, key->operand, sizeof(key->operand)) != 0 ||
+                memcmp(entry->operandLen, key->operandLen, sizeof(key->operandLen)) != 0) continue;
+
+#ifdef SETCAL_STATS
+            memoHits++;
+#endif
+            return entry;
         }
-        cmd = cmds->commands[i-initSize].functionNameIdx;
-        if (i >= initSize)
+    }
+#ifdef SETCAL_STATS
+    memoMisses++;
+#endif
+    return NULL;
+}
+
+/// Makes room for one more entry in the memo table, doubling it once it is half full
+/// \param memo the memo table
+/// \return true on success, false when the allocation fails
+int growMemo(memoTable_t *memo)
+{
+    if (memo->entries != NULL && 2 * (memo->count + 1) <= memo->size) return true;
+
+    int size = memo->entries == NULL ? INIT_TABLE_SIZE : 2 * memo->size;
+    memoEntry_t *entries = bigBrainRealloc(NULL, size * sizeof(memoEntry_t));
+    if (entries == NULL) return errMsg("Allocation failed.\n", false);
+
+    for (int i = 0; i < size; i++)
+    {
+        entries[i].op = EMPTY_SLOT;
+    }
+    for (int i = 0; i < memo->size; i++)
+    {
+        if (memo->entries[i].op == EMPTY_SLOT) continue;
+
+        unsigned slot = memo->entries[i].hash & (size - 1);
+        while (entries[slot].op != EMPTY_SLOT) slot = (slot + 1) & (size - 1);
+        entries[slot] = memo->entries[i];
+    }
+
+    memo->entries = entries;
+    memo->size = size;
+    return true;
+}
+
+/// Stores a command that has just run in the memo table together with the output it printed,
+/// an output that did not stay in the buffer is not known, the result is printed again instead
+/// \param memo the memo table
+/// \param key the key of the command
+/// \param answer the answer of the command
+/// \param result position of the stored result in its list, EMPTY_SLOT for a predicate
+/// \param relation the result is a relation
+/// \param out the output the command printed to
+/// \param mark number of bytes waiting in the buffer before the command ran
+/// \param flushed number of bytes handed to the stream before the command ran
+/// \return true on success, false when an allocation fails
+int remember(memoTable_t *memo, memoEntry_t *key, bool answer, int result, bool relation, output_t *out,
+             size_t mark, size_t flushed)
+{
+    bool known = out->flushed == flushed && out->len > mark;
+    if (!known && result == EMPTY_SLOT) return true;
+    if (!growMemo(memo)) return false;
+
+    key->answer = answer;
+    key->result = result;
+    key->relation = relation;
+    key->text = NULL;
+    key->textLen = 0;
+    if (known)
+    {
+        key->textLen = out->len - mark;
+        key->text = bigBrainRealloc(NULL, key->textLen);
+        if (key->text == NULL) return errMsg("Allocation failed.\n", false);
+        memcpy(key->text, out->buf + mark, key->textLen);
+    }
+
+    unsigned slot = key->hash & (memo->size - 1);
+    while (memo->entries[slot].op != EMPTY_SLOT) slot = (slot + 1) & (memo->size - 1);
+    memo->entries[slot] = *key;
+    memo->count++;
+    return true;
+}
+
+/// Prints the output of a command run before again and stores its result once more for the line of the command
+/// \param entry the entry of the command run before
+/// \param ins the instruction of the command
+/// \param cmds a list of all commands
+/// \param lines the line table
+/// \param sets a list of all sets
+/// \param relations a list of relations
+/// \param universe the universe over which is everything defined
+/// \param out the output the result is written to
+/// \return true on success, false when an allocation fails
+int replay(memoEntry_t *entry, instruction_t *ins, commandList_t *cmds, lineTable_t *lines, setList_t *sets,
+           relationList_t *relations, universe_t *universe, output_t *out)
+{
+    if (entry->text != NULL) outWrite(out, entry->text, entry->textLen);
+    if (entry->result == EMPTY_SLOT) return true;
+
+    command_t *cmd = &cmds->commands[ins->command];
+    if (entry->relation)
+    {
+        relation_t rel = relations->relations[entry->result];
+        if (!insertToRelatioList(&rel, relations)) return false;
+        bindRelationLine(lines, relations, cmd->idx);
+        if (entry->text == NULL) printRelation(&relations->relations[relations->relationList_len - 1], universe, out);
+    }
+    else
+    {
+        set_t set = sets->sets[entry->result];
+        if (!insertToSetList(&set, sets)) return false;
+        bindSetLine(lines, sets, cmd->idx);
+        if (entry->text == NULL && entry->op == 2)
         {
-            if (cmds->commands[i - initSize].morphed && (cmd < 9 || cmd == 22))
+            // the complement prints a space after its items
+            outString(out, "S");
+            for (int i = 0; i < set.set_len; i++)
             {
-                set_t *set = {0};
-                for (int j = 0; j < sets->setList_len; j++)
-                {
-                    if (cmds->commands[i - initSize].idx == sets->sets[j].index)
-                        set = &sets->sets[j];
-                }
-                printSet(set, universe);
-                continue;
-            }
-            else if (cmds->commands[i - initSize].morphed && cmd >= 9)
-            {
-                relation_t *relation = {0};
-                for (int j = 0; j < relations->relationList_len; j++)
-                {
-                    if (cmds->commands[i - initSize].idx == relations->relations[j].index)
-                        relation = &relations->relations[j];
-                }
-                printRelation(relation, universe);
-                continue;
-            }
-            if (!checkArgs(&cmds->commands[i-initSize], sets, relations, fileSize, &hasBonus, cmds, &emptS, &emptR))
-            {
-                return errMsg("Invalid arguments passed to function.\n", false);
+                outItem(out, universe, set.items[i]);
             }
+            outString(out, " \n");
         }
-        cmds->commands[i-initSize].exec = true;
+        else if (entry->text == NULL)
+            printSet(&sets->sets[sets->setList_len - 1], universe, out);
+    }
+    cmd->morphed = true;
+    return true;
+}
+
+/// Builds the lookup structures of all resolved operands of an instruction
+/// \param ins the instruction
+/// \param pos the positions of the operands
+/// \param sets a list of all sets
+/// \param relations a list of relations
+/// \param universe the universe over which is everything defined
+/// \return true on success, false on failure of an allocation
+int prepareOperands(instruction_t *ins, int *pos, setList_t *sets, relationList_t *relations, universe_t *universe)
+{
+    for (int k = 0; k < ins->argc; k++)
+    {
+        bool relation = operandIsRelation(ins->op, k);
+        if (!prepareOperand(relation ? (void *) &relations->relations[pos[k]] : (void *) &sets->sets[pos[k]],
+                            relation, universe))
+            return false;
+    }
+    return true;
+}
+
+/// Prepares an instruction to run, a command that has stored its result prints it again instead of running,
+/// the others get their operands naming command lines resolved, which may make a dummy empty set or relation
+/// \param ins the instruction
+/// \param pos the positions of the operands to be filled
+/// \param cmds a list of all commands
+/// \param lines the line table
+/// \param sets a list of all sets
+/// \param relations a list of relations
+/// \param universe the universe over which is everything defined
+/// \param emptS a variable in which the index of a dummy empty set is saved
+/// \param emptR a variable in which the index of a dummy empty relation is saved
+/// \param out the output the result is written to
+/// \return true when the command is to run, EMPTY_INDEX when its result was printed again, false on invalid operands
+int enterCommand(instruction_t *ins, int *pos, commandList_t *cmds, lineTable_t *lines, setList_t *sets,
+                 relationList_t *relations, universe_t *universe, int *emptS, int *emptR, output_t *out)
+{
+    command_t *cmd = &cmds->commands[ins->command];
+    if (cmd->morphed && lines->set[cmd->idx] != EMPTY_SLOT)
+    {
+        printSet(&sets->sets[lines->set[cmd->idx]], universe, out);
+        return EMPTY_INDEX;
+    }
+    else if (cmd->morphed && lines->relation[cmd->idx] != EMPTY_SLOT)
+    {
+        printRelation(&relations->relations[lines->relation[cmd->idx]], universe, out);
+        return EMPTY_INDEX;
+    }
+
+    for (int k = 0; k < ins->argc; k++)
+    {
+        pos[k] = ins->operand[k];
+        if (pos[k] != EMPTY_SLOT) continue;
+
+        if (operandIsRelation(ins->op, k))
+            pos[k] = findRel(relations, ins->operandLine[k], cmds, lines, emptR);
+        else
+            pos[k] = findSet(sets, ins->operandLine[k], cmds, lines, emptS);
+        if (pos[k] == INVALID_INDEX) return false;
+    }
+
+    if (ins->op == COMBINED_FUNCTIONS_LASTINDEX - 1 &&
+        findRel(relations, ins->operandLine[0], cmds, lines, emptR) == INVALID_INDEX &&
+        findSet(sets, ins->operandLine[0], cmds, lines, emptS) == INVALID_INDEX)
+        return false;
+
+    cmd->exec = true;
+    return true;
+}
 
-        switch (cmd)
+// the handlers of the dispatch loop, with computed goto every handler jumps straight to the next one,
+// the macros expand to several statements and end a handler, so they are never wrapped in a loop of their own
+#ifdef COMPUTED_GOTO
+#define HANDLER(op) case op: handler_##op:
+#define DISPATCH() if (pc >= program->len) return true; ins = &program->code[pc]; goto *handlers[ins->op]
+#else
+#define HANDLER(op) case op:
+#define DISPATCH() continue
+#endif
+
+// every command handler starts by printing a stored result again or resolving its operands
+#define ENTER() \
+    switch (enterCommand(ins, pos, cmds, lines, sets, relations, universe, &emptS, &emptR, out)) \
+    { \
+        case false: return errMsg("Invalid arguments passed to function.\n", false); \
+        case EMPTY_INDEX: pc++; DISPATCH(); \
+        default: break; \
+    }
+#define SET(k) (&sets->sets[pos[k]])
+#define REL(k) (&relations->relations[pos[k]])
+#define NEXT(answer) pc = !(answer) && ins->jump != EMPTY_SLOT ? ins->jump : pc + 1; DISPATCH()
+// a command run before on the same operands prints its output again, any other one notes where its output starts
+#define RECALL() \
+    memoKey(&key, ins, pos, sets, relations); \
+    if ((hit = recall(&memo, &key)) != NULL) \
+    { \
+        if (!replay(hit, ins, cmds, lines, sets, relations, universe, out)) return false; \
+        NEXT(hit->answer); \
+    } \
+    mark = out->len; \
+    flushed = out->flushed
+#define ANSWER(status) \
+    answered = (status); \
+    if (!remember(&memo, &key, answered, EMPTY_SLOT, false, out, mark, flushed)) return false; \
+    NEXT(answered)
+// a result nothing reads gives back the memory it took as soon as it is printed, the line is still noted,
+// so the objects stored after it are hidden the same way
+#define STORE_SET(status) \
+    if (ins->lazy && !prepareOperands(ins, pos, sets, relations, universe)) return false; \
+    checkpoint = arenaMark(&arena); \
+    if (!(status)) return false; \
+    if (ins->lazy) \
+    { \
+        arenaRollback(&arena, &checkpoint); \
+        if (cmds->commands[ins->command].idx > lines->setMax) lines->setMax = cmds->commands[ins->command].idx; \
+        cmds->commands[ins->command].morphed = true; \
+        NEXT(true); \
+    } \
+    if (!insertToSetList(&set, sets)) return false; \
+    bindSetLine(lines, sets, cmds->commands[ins->command].idx); \
+    cmds->commands[ins->command].morphed = true; \
+    if (!remember(&memo, &key, true, sets->setList_len - 1, false, out, mark, flushed)) return false; \
+    NEXT(true)
+#define STORE_RELATION(status) \
+    if (ins->lazy && !prepareOperands(ins, pos, sets, relations, universe)) return false; \
+    checkpoint = arenaMark(&arena); \
+    if (!(status)) return false; \
+    if (ins->lazy) \
+    { \
+        arenaRollback(&arena, &checkpoint); \
+        if (cmds->commands[ins->command].idx > lines->relationMax) \
+            lines->relationMax = cmds->commands[ins->command].idx; \
+        cmds->commands[ins->command].morphed = true; \
+        NEXT(true); \
+    } \
+    if (!insertToRelatioList(&rel, relations)) return false; \
+    bindRelationLine(lines, relations, cmds->commands[ins->command].idx); \
+    cmds->commands[ins->command].morphed = true; \
+    if (!remember(&memo, &key, true, relations->relationList_len - 1, true, out, mark, flushed)) return false; \
+    NEXT(true)
+
+/// Function encapsulating all functionality of the set calculator, everything important happens here \n
+/// Runs a compiled program from its first command, every instruction either continues with the next line or
+/// jumps, and a jump to a definition line prints that line again. A command run before on the same operands
+/// prints the remembered output and stores the remembered result instead of running, except select
+/// \param program the compiled program
+/// \param cmds list containing all commands in the file
+/// \param lines table resolving every line to what it holds
+/// \param sets list containing all sets in the file
+/// \param relations list containing all relations in the file
+/// \param universe the universe over which is everything defined
+/// \param out the output the result is written to
+/// \return true if the commands are successfully executed, false if an error happens in the process
+int execute(program_t *program, commandList_t *cmds, lineTable_t *lines, setList_t *sets, relationList_t *relations, universe_t *universe, output_t *out)
+{
+#ifdef COMPUTED_GOTO
+    static void *handlers[OP_COUNT] = {
+        &&handler_0, &&handler_1, &&handler_2, &&handler_3, &&handler_4, &&handler_5, &&handler_6, &&handler_7,
+        &&handler_8, &&handler_9, &&handler_10, &&handler_11, &&handler_12, &&handler_13, &&handler_14,
+        &&handler_15, &&handler_16, &&handler_17, &&handler_18, &&handler_19, &&handler_20, &&handler_21,
+        &&handler_22, &&handler_OP_PRINT_SET, &&handler_OP_PRINT_RELATION, &&handler_OP_INVALID
+    };
+#endif
+    int emptS = 0, emptR = 0, pos[MAX_OPERANDS];
+    int pc = program->start;
+    instruction_t *ins;
+    memoTable_t memo = {.entries = NULL, .size = 0, .count = 0};
+    memoEntry_t key, *hit;
+    size_t mark = 0, flushed = 0;
+    bool answered;
+    arenaMark_t checkpoint;
+
+    for (;;)
+    {
+        if (pc >= program->len) return true;
+        ins = &program->code[pc];
+
+#ifdef COMPUTED_GOTO
+        goto *handlers[ins->op];
+#endif
+        switch (ins->op)
         {
-            case 0:
+            HANDLER(0)
+                ENTER();
+                NEXT(empty(SET(0), out));
+            HANDLER(1)
+                ENTER();
+                card(SET(0), out);
+                NEXT(true);
+            HANDLER(2)
             {
-                if (!empty(&sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 2 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
-                }
-                break;
+                ENTER();
+                RECALL();
+                set_t set;
+                STORE_SET(complement(universe, SET(0), &set, out));
             }
-            case 1:
+            HANDLER(3)
             {
-                card(&sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)]);
-                break;
+                ENTER();
+                RECALL();
+                set_t set;
+                STORE_SET(Union(universe, SET(0), SET(1), &set, out));
             }
-            case 2:
+            HANDLER(4)
             {
+                ENTER();
+                RECALL();
                 set_t set;
-                if (complement(universe, &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)], &set))
-                {
-                    if (insertToSetList(&set, sets))
-                        sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
+                STORE_SET(intersect(universe, SET(0), SET(1), &set, out));
             }
-            case 3:
+            HANDLER(5)
             {
+                ENTER();
+                RECALL();
                 set_t set;
-                if (Union(universe, &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)],
-                          &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], &set))
-                {
-                    if (insertToSetList(&set, sets))
-                        sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
+                STORE_SET(minus(universe, SET(0), SET(1), &set, out));
             }
-            case 4:
+            HANDLER(6)
+                ENTER();
+                RECALL();
+                ANSWER(subseteq(universe, SET(0), SET(1), true, out));
+            HANDLER(7)
+                ENTER();
+                RECALL();
+                ANSWER(subset(universe, SET(0), SET(1), out));
+            HANDLER(8)
+                ENTER();
+                RECALL();
+                ANSWER(equals(universe, SET(0), SET(1), out));
+            HANDLER(9)
+                ENTER();
+                RECALL();
+                ANSWER(reflexive(universe, REL(0), out));
+            HANDLER(10)
+                ENTER();
+                RECALL();
+                ANSWER(symmetric(universe, REL(0), out));
+            HANDLER(11)
+                ENTER();
+                RECALL();
+                ANSWER(antisymmetric(universe, REL(0), out));
+            HANDLER(12)
+                ENTER();
+                RECALL();
+                ANSWER(transitive(universe, REL(0), out));
+            HANDLER(13)
+                ENTER();
+                RECALL();
+                ANSWER(function(universe, REL(0), out));
+            HANDLER(14)
             {
+                ENTER();
+                RECALL();
                 set_t set;
-                if (intersect(universe, &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)],
-                              &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], &set))
-                {
-                    if (insertToSetList(&set, sets))
-                        sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
+                STORE_SET(domain(universe, REL(0), &set, out));
             }
-            case 5:
+            HANDLER(15)
             {
+                ENTER();
+                RECALL();
                 set_t set;
-                if (minus(universe, &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)],
-                          &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], &set))
-                {
-                    if (insertToSetList(&set, sets))
-                        sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
+                STORE_SET(codomain(universe, REL(0), &set, out));
             }
-            case 6:
+            HANDLER(16)
             {
-                if (!subseteq(&sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)],
-                              &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], true))
-                {
-                    if (cmds->commands[i-initSize].argc == 3 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[2] - 2;
-                }
-                break;
+                ENTER();
+                RECALL();
+                relation_t rel;
+                STORE_RELATION(closure_ref(REL(0), universe, &rel, out));
             }
-            case 7:
+            HANDLER(17)
             {
-                if (!subset(&sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)],
-                            &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 3 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[2] - 2;
-                }
-                break;
+                ENTER();
+                RECALL();
+                relation_t rel;
+                STORE_RELATION(closure_sym(REL(0), universe, &rel, out));
             }
-            case 8:
+            HANDLER(18)
             {
-                if (!equals(&sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS)],
-                            &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 3 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[2] - 2;
-                }
-                break;
+                ENTER();
+                RECALL();
+                relation_t rel;
+                STORE_RELATION(closure_trans(REL(0), universe, &rel, out));
             }
-            case 9:
-                if (!reflexive(universe, &relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 2 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
-                }
-                break;
-            case 10:
-                if (!symmetric(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)]))
+            HANDLER(19)
+                ENTER();
+                RECALL();
+                ANSWER(injective(universe, REL(0), SET(1), SET(2), out));
+            HANDLER(20)
+                ENTER();
+                RECALL();
+                ANSWER(surjective(universe, REL(0), SET(1), SET(2), out));
+            HANDLER(21)
+                ENTER();
+                RECALL();
+                ANSWER(bijective(universe, REL(0), SET(1), SET(2), out));
+            HANDLER(22)
+            {
+                ENTER();
+                relation_t *r = NULL; set_t *s = NULL, set;
+                int idxS = findSet(sets, ins->operandLine[0], cmds, lines, &emptS);
+                int idxR = findRel(relations, ins->operandLine[0], cmds, lines, &emptR);
+                if (emptS != 0 || emptR != 0)
                 {
-                    if (cmds->commands[i-initSize].argc == 2 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
+                    s = NULL;
+                    r = NULL;
                 }
-                break;
-            case 11:
-                if (!antisymmetric(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)]))
+                else if (idxS == INVALID_INDEX && idxR != INVALID_INDEX)
                 {
-                    if (cmds->commands[i-initSize].argc == 2 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
+                    s = NULL;
+                    r = &relations->relations[idxR];
                 }
-                break;
-            case 12:
-                if (!transitive(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)]))
+                else if (idxS != INVALID_INDEX && idxR == INVALID_INDEX)
                 {
-                    if (cmds->commands[i-initSize].argc == 2 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
+                    r = NULL;
+                    s = &sets->sets[idxS];
                 }
-                break;
-            case 13:
-                if (!function(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)]))
+                bool selected = select_rand(r, s, universe, &set, out);
+                if (selected && ins->lazy)
                 {
-                    if (cmds->commands[i-initSize].argc == 2 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
+                    if (cmds->commands[ins->command].idx > lines->setMax) lines->setMax = cmds->commands[ins->command].idx;
                 }
-                break;
-            case 14:
-            {
-                set_t set;
-                if (domain(universe, &relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], &set) &&
-                    insertToSetList(&set, sets))
+                else if (selected)
                 {
-                    sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
+                    if (!insertToSetList(&set, sets)) return false;
+                    bindSetLine(lines, sets, cmds->commands[ins->command].idx);
                 }
-                else return false;
-                cmds->commands[i-initSize].morphed = true;
-
-                break;
+                cmds->commands[ins->command].morphed = true;
+                NEXT(selected);
             }
-            case 15:
-            {
-                set_t set;
-                if (codomain(universe, &relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], &set) &&
-                    insertToSetList(&set, sets))
-                {
-                    sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
-                }
-                else return false;
-                cmds->commands[i-initSize].morphed = true;
+            HANDLER(OP_PRINT_SET)
+                printSet(&sets->sets[ins->operand[0]], universe, out);
+                NEXT(true);
+            HANDLER(OP_PRINT_RELATION)
+                printRelation(&relations->relations[ins->operand[0]], universe, out);
+                NEXT(true);
+            HANDLER(OP_INVALID)
+                return errMsg("Invalid arguments passed to function.\n", false);
+        }
+    }
+}
 
-                break;
-            }
-            case 16:
-            {
-                relation_t rel;
-                if (closure_ref(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], universe, &rel))
-                {
-                    if (insertToRelatioList(&rel, relations))
-                    {
-                        relations->relations[relations->relationList_len - 1].index = cmds->commands[i-initSize].idx;
-                    }
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
-            }
-            case 17:
-            {
-                relation_t rel;
-                if (closure_sym(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], universe, &rel))
-                {
-                    if (insertToRelatioList(&rel, relations))
-                    {
-                        relations->relations[relations->relationList_len - 1].index = cmds->commands[i-initSize].idx;
-                    }
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
-            }
-            case 18:
+#undef HANDLER
+#undef DISPATCH
+#undef ENTER
+#undef SET
+#undef REL
+#undef NEXT
+#undef RECALL
+#undef ANSWER
+#undef STORE_SET
+#undef STORE_RELATION
+
+#ifdef THREADED_EXECUTE
+/// a command of a program without jumps, run by one of the worker threads
+typedef struct
+{
+    int pc; ///< instruction of the command
+    int pending; ///< number of commands whose results it still waits for
+    void *operand[MAX_OPERANDS]; ///< the set or relation of every operand
+    set_t set; ///< the result of a command making a set
+    relation_t rel; ///< the result of a command making a relation
+    bool done; ///< the command has run
+    char *text; ///< the printed output of the command, allocated by its memory stream
+    size_t textLen; ///< length of the printed output
+} task_t;
+
+/// the commands of a program without jumps with the lines they wait for, shared by the worker threads
+typedef struct
+{
+    program_t *program; ///< the program the tasks come from
+    universe_t *universe; ///< the universe over which is everything defined
+    task_t *tasks; ///< one task per command, in the order of the lines
+    int count; ///< number of tasks
+    int *taskOf; ///< the task of every instruction, EMPTY_SLOT for a definition line
+    int *dependStart; ///< count + 1 offsets into dependent, the tasks waiting for task t start at dependStart[t]
+    int *dependent; ///< the tasks waiting for every task, once for every operand naming it
+    int *ready; ///< stack of the tasks whose operands are all known
+    int readyLen; ///< number of tasks on the stack
+    int finished; ///< number of tasks that have run
+    bool failed; ///< a task failed or the output stopped, no more tasks are started
+    pthread_mutex_t lock; ///< guards the stack, the counters and the flags of the tasks
+    pthread_cond_t wake; ///< signalled whenever a task gets ready or has run
+} schedule_t;
+
+/// a worker thread with the arena it allocates from
+typedef struct
+{
+    schedule_t *plan; ///< the tasks to run
+    arena_t arena; ///< the arena of the thread, handed over to the global arena once it ends
+    pthread_t thread; ///< the thread
+} worker_t;
+
+/// Plans a program as tasks, every operand naming a command line makes its task wait for that command \n
+/// Only a program without jumps and select whose every operand is known before it runs is planned,
+/// its commands then run exactly once in the order of the lines, so a task may run as soon as its operands are known
+/// \param plan the schedule to be filled
+/// \param program the compiled program
+/// \param sets a list of all sets
+/// \param relations a list of relations
+/// \param universe the universe over which is everything defined
+/// \return true on success, false on failure of an allocation, EMPTY_INDEX when the program has to run sequentially
+int planTasks(schedule_t *plan, program_t *program, setList_t *sets, relationList_t *relations, universe_t *universe)
+{
+    plan->program = program;
+    plan->universe = universe;
+    plan->count = 0;
+    plan->readyLen = 0;
+    plan->finished = 0;
+    plan->failed = false;
+    plan->taskOf = bigBrainRealloc(NULL, (program->len > 0 ? program->len : 1) * sizeof(int));
+    if (plan->taskOf == NULL) return errMsg("Allocation failed.\n", false);
+
+    for (int pc = 0; pc < program->len; pc++)
+    {
+        instruction_t *ins = &program->code[pc];
+        plan->taskOf[pc] = EMPTY_SLOT;
+        if (pc < program->start || ins->op == OP_PRINT_SET || ins->op == OP_PRINT_RELATION) continue;
+        if (ins->op == OP_INVALID || ins->op == COMBINED_FUNCTIONS_LASTINDEX - 1 || ins->jump != EMPTY_SLOT)
+            return EMPTY_INDEX;
+
+        // an operand naming a command line has to name an earlier command making an object of its kind
+        for (int k = 0; k < ins->argc; k++)
+        {
+            int source = ins->operandLine[k] - 1;
+            if (ins->operand[k] == EMPTY_SLOT &&
+                (source < program->start || source >= pc || plan->taskOf[source] == EMPTY_SLOT ||
+                 !makesObject(program->code[source].op, operandIsRelation(ins->op, k))))
+                return EMPTY_INDEX;
+        }
+        plan->taskOf[pc] = plan->count++;
+    }
+
+    int count = plan->count > 0 ? plan->count : 1;
+    plan->tasks = bigBrainRealloc(NULL, count * sizeof(task_t));
+    plan->dependStart = bigBrainRealloc(NULL, (count + 1) * sizeof(int));
+    plan->dependent = bigBrainRealloc(NULL, count * MAX_OPERANDS * sizeof(int));
+    plan->ready = bigBrainRealloc(NULL, count * sizeof(int));
+    if (plan->tasks == NULL || plan->dependStart == NULL || plan->dependent == NULL || plan->ready == NULL)
+        return errMsg("Allocation failed.\n", false);
+    memset(plan->dependStart, 0, (count + 1) * sizeof(int));
+
+    // the operands are resolved once, a definition is prepared right away, a result by the task making it
+    for (int pc = program->start; pc < program->len; pc++)
+    {
+        if (plan->taskOf[pc] == EMPTY_SLOT) continue;
+
+        instruction_t *ins = &program->code[pc];
+        task_t *task = &plan->tasks[plan->taskOf[pc]];
+        task->pc = pc;
+        task->pending = 0;
+        task->done = false;
+        task->text = NULL;
+        task->textLen = 0;
+        for (int k = 0; k < ins->argc; k++)
+        {
+            bool relation = operandIsRelation(ins->op, k);
+            if (ins->operand[k] == EMPTY_SLOT)
             {
-                relation_t rel;
-                if (closure_trans(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], universe, &rel))
-                {
-                    if (insertToRelatioList(&rel, relations))
-                    {
-                        relations->relations[relations->relationList_len - 1].index = cmds->commands[i-initSize].idx;
-                    }
-                    else return false;
-                    cmds->commands[i-initSize].morphed = true;
-                }
-                else return false;
-                break;
+                task_t *source = &plan->tasks[plan->taskOf[ins->operandLine[k] - 1]];
+                task->operand[k] = relation ? (void *) &source->rel : (void *) &source->set;
+                task->pending++;
+                plan->dependStart[plan->taskOf[ins->operandLine[k] - 1] + 1]++;
+                continue;
             }
-            case 19:
-                if (!injective(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[2], cmds, &emptS)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 4 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[3] - 2;
-                }
-                break;
-            case 20:
-                if (!surjective(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[2], cmds, &emptS)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 4 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[3] - 2;
-                }
-                break;
-            case 21:
-                if (!bijective(&relations->relations[findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR)], &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[1], cmds, &emptS)], &sets->sets[findSet(sets, cmds->commands[i-initSize].parameters[2], cmds, &emptS)]))
-                {
-                    if (cmds->commands[i-initSize].argc == 4 && hasBonus)
-                        i = cmds->commands[i-initSize].parameters[3] - 2;
-                }
-                break;
-            case 22:
+
+            task->operand[k] = relation ? (void *) &relations->relations[ins->operand[k]] : (void *) &sets->sets[ins->operand[k]];
+            if (!prepareOperand(task->operand[k], relation, universe)) return false;
+        }
+    }
+
+    for (int t = 0; t < plan->count; t++)
+    {
+        plan->dependStart[t + 1] += plan->dependStart[t];
+    }
+    for (int t = 0; t < plan->count; t++)
+    {
+        instruction_t *ins = &program->code[plan->tasks[t].pc];
+        for (int k = 0; k < ins->argc; k++)
+        {
+            if (ins->operand[k] != EMPTY_SLOT) continue;
+
+            // the offset of the source is moved along while filling and moved back below
+            plan->dependent[plan->dependStart[plan->taskOf[ins->operandLine[k] - 1]]++] = t;
+        }
+    }
+    for (int t = plan->count; t > 0; t--)
+    {
+        plan->dependStart[t] = plan->dependStart[t - 1];
+    }
+    plan->dependStart[0] = 0;
+
+    // the earliest lines are taken from the stack first, so the output can be written early
+    for (int t = plan->count - 1; t >= 0; t--)
+    {
+        if (plan->tasks[t].pending == 0) plan->ready[plan->readyLen++] = t;
+    }
+    return true;
+}
+
+/// Runs a single task, its output is written to a memory stream of its own
+/// \param plan the schedule of the task
+/// \param task the task
+/// \param out the output buffer of the worker
+/// \return true on success, false on failure of an allocation
+int runTask(schedule_t *plan, task_t *task, output_t *out)
+{
+    instruction_t *ins = &plan->program->code[task->pc];
+    universe_t *universe = plan->universe;
+    set_t *S[MAX_OPERANDS];
+    relation_t *R[MAX_OPERANDS];
+    for (int k = 0; k < MAX_OPERANDS; k++)
+    {
+        S[k] = task->operand[k];
+        R[k] = task->operand[k];
+    }
+
+    out->file = open_memstream(&task->text, &task->textLen);
+    if (out->file == NULL) return errMsg("Allocation failed.\n", false);
+
+    task->set = (set_t) {.items = NULL, .set_len = 0, .bits = NULL, .sorted = NULL, .chunks = NULL, .index = task->pc + 1};
+    task->rel = (relation_t) {.items = NULL, .relation_len = 0, .csr = NULL, .index = task->pc + 1};
+    int status = true;
+    switch (ins->op)
+    {
+        case 0: empty(S[0], out); break;
+        case 1: card(S[0], out); break;
+        case 2: status = complement(universe, S[0], &task->set, out); break;
+        case 3: status = Union(universe, S[0], S[1], &task->set, out); break;
+        case 4: status = intersect(universe, S[0], S[1], &task->set, out); break;
+        case 5: status = minus(universe, S[0], S[1], &task->set, out); break;
+        case 6: subseteq(universe, S[0], S[1], true, out); break;
+        case 7: subset(universe, S[0], S[1], out); break;
+        case 8: equals(universe, S[0], S[1], out); break;
+        case 9: reflexive(universe, R[0], out); break;
+        case 10: symmetric(universe, R[0], out); break;
+        case 11: antisymmetric(universe, R[0], out); break;
+        case 12: transitive(universe, R[0], out); break;
+        case 13: function(universe, R[0], out); break;
+        case 14: status = domain(universe, R[0], &task->set, out); break;
+        case 15: status = codomain(universe, R[0], &task->set, out); break;
+        case 16: status = closure_ref(R[0], universe, &task->rel, out); break;
+        case 17: status = closure_sym(R[0], universe, &task->rel, out); break;
+        case 18: status = closure_trans(R[0], universe, &task->rel, out); break;
+        case 19: injective(universe, R[0], S[1], S[2], out); break;
+        case 20: surjective(universe, R[0], S[1], S[2], out); break;
+        case 21: bijective(universe, R[0], S[1], S[2], out); break;
+        default: break;
+    }
+    outFlush(out);
+    if (fclose(out->file) != 0) status = errMsg("Allocation failed.\n", false);
+    if (!status) return false;
+
+    // the result is made ready for the tasks waiting for it before they may read it
+    if (makesObject(ins->op, false))
+    {
+        task->set.index = task->pc + 1;
+        fingerprintSet(&task->set);
+        return prepareOperand(&task->set, false, universe);
+    }
+    if (makesObject(ins->op, true))
+    {
+        task->rel.index = task->pc + 1;
+        return prepareOperand(&task->rel, true, universe);
+    }
+    return true;
+}
+
+/// Body of a worker thread, takes the ready tasks one by one until all have run or one of them fails
+/// \param data the worker
+/// \return NULL
+void *runWorker(void *data)
+{
+    worker_t *worker = data;
+    schedule_t *plan = worker->plan;
+    pthread_setspecific(arenaKey, &worker->arena);
+
+    output_t out = {.buf = bigBrainRealloc(NULL, OUTPUT_BUFFER_SIZE), .len = 0, .flushed = 0, .file = NULL};
+    pthread_mutex_lock(&plan->lock);
+    if (out.buf == NULL)
+    {
+        plan->failed = true;
+        pthread_cond_broadcast(&plan->wake);
+        errMsg("Allocation failed.\n", false);
+    }
+
+    for (;;)
+    {
+        while (plan->readyLen == 0 && plan->finished < plan->count && !plan->failed)
+        {
+            pthread_cond_wait(&plan->wake, &plan->lock);
+        }
+        if (plan->readyLen == 0 || plan->failed) break;
+
+        task_t *task = &plan->tasks[plan->ready[--plan->readyLen]];
+        pthread_mutex_unlock(&plan->lock);
+        int status = runTask(plan, task, &out);
+        pthread_mutex_lock(&plan->lock);
+
+        plan->finished++;
+        if (!status) plan->failed = true;
+        else
+        {
+            task->done = true;
+            int t = task - plan->tasks;
+            for (int i = plan->dependStart[t]; i < plan->dependStart[t + 1]; i++)
             {
-                relation_t *r = NULL; set_t *s = NULL, set;
-                int idxS = findSet(sets, cmds->commands[i-initSize].parameters[0], cmds, &emptS);
-                int idxR = findRel(relations, cmds->commands[i-initSize].parameters[0], cmds, &emptR);
-                if (emptS != 0 || emptR != 0)
-                {
-                    s = NULL;
-                    r = NULL;
-                }
-                else if (idxS == INVALID_INDEX && idxR != INVALID_INDEX)
-                {
-                    s = NULL;
-                    r = &relations->relations[idxR];
-                }
-                else if (idxS != INVALID_INDEX && idxR == INVALID_INDEX)
-                {
-                    r = NULL;
-                    s = &sets->sets[idxS];
-                }
-                if (!select_rand(r, s, universe, &set))
-                {
-                    if (cmds->commands[i-initSize].argc == 2)
-                        i = cmds->commands[i-initSize].parameters[1] - 2;
-                }
-                else if (insertToSetList(&set, sets))
-                    sets->sets[sets->setList_len - 1].index = cmds->commands[i-initSize].idx;
-                else return false;
-                cmds->commands[i-initSize].morphed = true;
-                break;
+                if (--plan->tasks[plan->dependent[i]].pending == 0) plan->ready[plan->readyLen++] = plan->dependent[i];
             }
-            default: return false;
         }
+        pthread_cond_broadcast(&plan->wake);
     }
-    return true;
+    pthread_mutex_unlock(&plan->lock);
+    pthread_setspecific(arenaKey, NULL);
+    return NULL;
 }
 
-/// Function that reads the contents of the file into memory and begins the execution of all commands
-/// \param file the file to be read
+/// Runs a program without jumps on threadCount worker threads, a command runs as soon as the commands it names
+/// have run, the outputs are written in the order of the lines, so the output is the same as of execute
+/// \param program the compiled program
+/// \param cmds list containing all commands in the file
+/// \param sets list containing all sets in the file
+/// \param relations list containing all relations in the file
+/// \param universe the universe over which is everything defined
+/// \param out the output the result is written to
+/// \return true if the commands are successfully executed, false if an error happens in the process,
+/// EMPTY_INDEX when the program has to be run by execute
+int executeThreaded(program_t *program, commandList_t *cmds, setList_t *sets, relationList_t *relations,
+                    universe_t *universe, output_t *out)
+{
+    schedule_t plan;
+    int status = planTasks(&plan, program, sets, relations, universe);
+    if (status != true) return status;
+
+    worker_t *workers = bigBrainRealloc(NULL, threadCount * sizeof(worker_t));
+    if (workers == NULL) return errMsg("Allocation failed.\n", false);
+    pthread_mutex_init(&plan.lock, NULL);
+    pthread_cond_init(&plan.wake, NULL);
+
+    int started = 0;
+    for (; started < threadCount; started++)
+    {
+        workers[started].plan = &plan;
+        workers[started].arena = (arena_t) {.blocks = NULL, .current = NULL, .last = NULL, .allocations = 0,
+                                            .blockCount = 0, .used = 0, .peak = 0};
+        if (pthread_create(&workers[started].thread, NULL, runWorker, &workers[started]) != 0) break;
+    }
+
+    // the main thread writes the outputs in the order of the lines while the workers run the tasks
+    status = started > 0 ? true : EMPTY_INDEX;
+    for (int pc = program->start; pc < program->len && status == true; pc++)
+    {
+        instruction_t *ins = &program->code[pc];
+        if (ins->op == OP_PRINT_SET)
+        {
+            printSet(&sets->sets[ins->operand[0]], universe, out);
+            continue;
+        }
+        if (ins->op == OP_PRINT_RELATION)
+        {
+            printRelation(&relations->relations[ins->operand[0]], universe, out);
+            continue;
+        }
+
+        task_t *task = &plan.tasks[plan.taskOf[pc]];
+        pthread_mutex_lock(&plan.lock);
+        while (!task->done && !plan.failed)
+        {
+            pthread_cond_wait(&plan.wake, &plan.lock);
+        }
+        bool done = task->done;
+        pthread_mutex_unlock(&plan.lock);
+        if (!done)
+        {
+            status = false;
+            break;
+        }
+
+        outWrite(out, task->text, task->textLen);
+        free(task->text);
+        task->text = NULL;
+        cmds->commands[ins->command].exec = true;
+        if (makesObject(ins->op, false) || makesObject(ins->op, true)) cmds->commands[ins->command].morphed = true;
+    }
+
+    pthread_mutex_lock(&plan.lock);
+    plan.failed = plan.failed || status != true;
+    pthread_cond_broadcast(&plan.wake);
+    pthread_mutex_unlock(&plan.lock);
+    for (int w = 0; w < started; w++)
+    {
+        pthread_join(workers[w].thread, NULL);
+        arenaAdopt(&arena, &workers[w].arena);
+    }
+    for (int t = 0; t < plan.count; t++)
+    {
+        free(plan.tasks[t].text);
+    }
+    pthread_mutex_destroy(&plan.lock);
+    pthread_cond_destroy(&plan.wake);
+    return status;
+}
+#endif
+
+/// Splits the input into lines, the scan stops once more lines than a file may have are found
+/// \param input the input buffer containing the file
+/// \param lines array with room for MAX_NUM_LINES + 1 lines
+/// \return the number of lines found
+int indexLines(input_t *input, line_t *lines)
+{
+    int count = 0;
+    long pos = 0;
+
+    while (pos < input->len && count <= MAX_NUM_LINES)
+    {
+        const char *newline = memchr(input->data + pos, '\n', input->len - pos);
+        long end = newline != NULL ? newline - input->data : input->len;
+
+        lines[count].start = pos;
+        lines[count].len = end - pos;
+        count++;
+        pos = end + 1;
+    }
+    return count;
+}
+
+/// Parses a set, relation or command line on its own, the line depends only on the universe
+/// \param parsed container for the parsed line
+/// \param input the input buffer containing the file
+/// \param line the line to be parsed, its first character is S, R or C
+/// \param lineIndex number of the line
+/// \param universe the universe over which is everything defined
+/// \param scratch scratch memory of the parser
+void parseLine(parsedLine_t *parsed, input_t *input, line_t *line, int lineIndex, universe_t *universe, parseScratch_t *scratch)
+{
+    // the readers see the end of the line as the end of their input
+    input_t view = {.data = input->data + line->start, .len = line->len, .pos = 1};
+    parsed->commands = (commandList_t) {.commands = &parsed->command, .commandList_len = 0, .commandList_cap = 1};
+    parsed->message = NULL;
+
+    if (view.data[0] == 'S') parsed->status = readSet(&parsed->set, &view, universe, scratch);
+    else if (view.data[0] == 'R') parsed->status = readRelation(&parsed->relation, &view, universe, scratch);
+    else parsed->status = readCommands(&view, &parsed->commands, lineIndex);
+}
+
+/// Takes a parsed line in the order of the lines, a line not parsed by the worker threads is parsed now
+/// \param parsed the line parsed by the worker threads, NULL when the lines are parsed one by one
+/// \param own container for a line parsed now
+/// \param input the input buffer containing the file
+/// \param line the line to be taken
+/// \param lineIndex number of the line
+/// \param universe the universe over which is everything defined
+/// \param scratch scratch memory of the parser
+/// \return the parsed line
+parsedLine_t *takeLine(parsedLine_t *parsed, parsedLine_t *own, input_t *input, line_t *line, int lineIndex,
+                       universe_t *universe, parseScratch_t *scratch)
+{
+    if (parsed == NULL)
+    {
+        parseLine(own, input, line, lineIndex, universe, scratch);
+        return own;
+    }
+
+    // the message is printed only once all lines before it are taken, so the first bad line reports first
+    if (parsed->message != NULL) errMsg(parsed->message, false);
+    return parsed;
+}
+
+#ifdef THREADED_EXECUTE
+/// a worker thread parsing a share of the lines with the arena it allocates from
+typedef struct
+{
+    input_t *input; ///< the input buffer containing the file
+    line_t *lines; ///< all lines of the file
+    parsedLine_t *parsed; ///< the parsed lines, one per line of the file
+    universe_t *universe; ///< the universe over which is everything defined
+    int from; ///< first line of the share
+    int to; ///< the line after the share
+    arena_t arena; ///< the arena of the thread, handed over to the global arena once it ends
+    pthread_t thread; ///< the thread
+    bool started; ///< the thread was started, otherwise the share was parsed by the calling thread
+} parser_t;
+
+/// Parses the set, relation and command lines of a share, the error messages are kept with their lines
+/// \param data the parser
+/// \return NULL
+void *runParser(void *data)
+{
+    parser_t *parser = data;
+    parseScratch_t scratch = {.seen = NULL, .pairs = NULL, .pairs_size = 0, .pairs_count = 0, .generation = 0};
+    char *message;
+    pthread_setspecific(arenaKey, &parser->arena);
+    pthread_setspecific(messageKey, &message);
+
+    for (int i = parser->from; i < parser->to; i++)
+    {
+        line_t *line = &parser->lines[i];
+        char c = line->len > 0 ? parser->input->data[line->start] : '\n';
+        if (c != 'S' && c != 'R' && c != 'C') continue;
+
+        message = NULL;
+        parseLine(&parser->parsed[i], parser->input, line, i + 1, parser->universe, &scratch);
+        parser->parsed[i].message = message;
+    }
+
+    pthread_setspecific(messageKey, NULL);
+    pthread_setspecific(arenaKey, NULL);
+    return NULL;
+}
+
+/// Parses the lines after the universe on threadCount worker threads, every thread takes a share of about
+/// the same number of bytes and the lines are taken by readFile in their order once all threads have ended
+/// \param input the input buffer containing the file
+/// \param lines all lines of the file
+/// \param from first line to be parsed, at least one line is left to be parsed
+/// \param lineCount number of lines of the file
+/// \param universe the universe over which is everything defined
+/// \return the parsed lines, one per line of the file, NULL on failure of an allocation
+parsedLine_t *parseThreaded(input_t *input, line_t *lines, int from, int lineCount, universe_t *universe)
+{
+    parsedLine_t *parsed = bigBrainRealloc(NULL, lineCount * sizeof(parsedLine_t));
+    parser_t *parsers = bigBrainRealloc(NULL, threadCount * sizeof(parser_t));
+    if (parsed == NULL || parsers == NULL) return NULL;
+
+    long bytes = lines[lineCount - 1].start + lines[lineCount - 1].len - lines[from].start;
+    int line = from;
+    for (int w = 0; w < threadCount; w++)
+    {
+        parsers[w] = (parser_t) {.input = input, .lines = lines, .parsed = parsed, .universe = universe, .from = line,
+                                 .arena = {.blocks = NULL, .current = NULL, .last = NULL, .allocations = 0,
+                                           .blockCount = 0, .used = 0, .peak = 0}};
+
+        // the share ends at the first line past its part of the bytes
+        long end = lines[from].start + bytes / threadCount * (w + 1);
+        while (line < lineCount && (w == threadCount - 1 || lines[line].start < end)) line++;
+        parsers[w].to = line;
+    }
+
+    // a share whose thread cannot be started is parsed by the calling thread
+    for (int w = 0; w < threadCount; w++)
+    {
+        parsers[w].started = pthread_create(&parsers[w].thread, NULL, runParser, &parsers[w]) == 0;
+        if (!parsers[w].started) runParser(&parsers[w]);
+    }
+    for (int w = 0; w < threadCount; w++)
+    {
+        if (parsers[w].started) pthread_join(parsers[w].thread, NULL);
+        arenaAdopt(&arena, &parsers[w].arena);
+    }
+    return parsed;
+}
+#endif
+
+/// Function that parses and validates the contents of the file
+/// \param input the input buffer containing the file
 /// \param universe the universe over which is everything defined
 /// \param relations list containing all relations in the file
 /// \param sets list containing all sets in the file
 /// \param commands list containing all commands in the file
+/// \param initSize the number of lines that are not command definitions
+/// \param fileSize the number of lines in the entire file
 /// \return 0 if the entire file is successfully read
-/// \return EXIT_FAILURE if an error happens during the file execution
-int readFile(FILE *file, universe_t *universe, relationList_t *relations, setList_t *sets, commandList_t *commands)
+/// \return EXIT_FAILURE if an error happens during reading
+int readFile(input_t *input, universe_t *universe, relationList_t *relations, setList_t *sets, commandList_t *commands, int *initSize, int *fileSize)
 {
     char c;
     int count = 0, hasU = 0, hasRorS = 0, hasC = 0;
+    parseScratch_t scratch = {.seen = NULL, .pairs = NULL, .pairs_size = 0, .pairs_count = 0, .generation = 0};
+    parsedLine_t own, *parsed = NULL;
+
+    // the first pass only locates the lines, so every line is parsed on its own
+    line_t *lines = bigBrainRealloc(NULL, (MAX_NUM_LINES + 1) * sizeof(line_t));
+    if (lines == NULL) return errMsg("Allocation failed.\n", EXIT_FAILURE);
+    int lineCount = indexLines(input, lines);
+
+    // the lists are sized from the line types, so no list grows while the lines are parsed
+    int setCount = 1, relationCount = 0, commandCount = 0;
+    for (int i = 0; i < lineCount; i++)
+    {
+        c = lines[i].len > 0 ? input->data[lines[i].start] : '\n';
+        setCount += c == 'S';
+        relationCount += c == 'R';
+        commandCount += c == 'C';
+    }
+    sets->sets = growArray(sets->sets, &sets->setList_cap, setCount, sizeof(set_t));
+    relations->relations = growArray(relations->relations, &relations->relationList_cap, relationCount, sizeof(relation_t));
+    commands->commands = growArray(commands->commands, &commands->commandList_cap, commandCount, sizeof(command_t));
+    if (sets->sets == NULL || (relations->relations == NULL && relationCount > 0) || (commands->commands == NULL && commandCount > 0))
+        return errMsg("Allocation failed.\n", EXIT_FAILURE);
 
-    while (fscanf(file, "%c", &c) != EOF)
+    for (int i = 0; i < lineCount; i++)
     {
         if (++count > MAX_NUM_LINES) return errMsg("The file cannot be more than 1000 lines long.\n", EXIT_FAILURE);
 
+        // the readers see the end of the line as the end of their input
+        input_t line = {.data = input->data + lines[i].start, .len = lines[i].len, .pos = 0};
+        c = line.len > 0 ? line.data[line.pos++] : '\n';
+
         switch (c)
         {
             case 'U':
             {
                 if (++hasU > 1) return errMsg("Invalid file structure.\n", EXIT_FAILURE);
 
-                if (appendUniverse(universe, sets, file))
+                if (appendUniverse(universe, sets, &line))
                 {
                     sets->sets[sets->setList_len - 1].index = count;
                 }
                 else return EXIT_FAILURE;
 
+#ifdef THREADED_EXECUTE
+                // the lines after the universe depend only on it, the lines past the limit are never taken
+                int parseCount = lineCount < MAX_NUM_LINES ? lineCount : MAX_NUM_LINES;
+                if (threadCount > 1 && i + 1 < parseCount)
+                {
+                    parsed = parseThreaded(input, lines, i + 1, parseCount, universe);
+                    if (parsed == NULL) return errMsg("Allocation failed.\n", EXIT_FAILURE);
+                }
+#endif
                 break;
             }
             case 'S':
             {
                 if (!hasU || hasC) return errMsg("Invalid file structure.\n", EXIT_FAILURE);
 
-                set_t set;
-                if (readSet(&set, file, universe) && insertToSetList(&set, sets))
+                parsedLine_t *result = takeLine(parsed != NULL ? &parsed[i] : NULL, &own, input, &lines[i], count, universe, &scratch);
+                if (result->status && insertToSetList(&result->set, sets))
                 {
                     hasRorS++;
                     sets->sets[sets->setList_len - 1].index = count;
                 }
-                else
-                {
-                    free(set.items);
-                    return EXIT_FAILURE;
-                }
+                else return EXIT_FAILURE;
                 break;
             }
             case 'R':
             {
                 if (!hasU || hasC) return errMsg("Invalid file structure.\n", EXIT_FAILURE);
 
-                relation_t relation;
-                if (readRelation(&relation, file, universe) && insertToRelatioList(&relation, relations))
+                parsedLine_t *result = takeLine(parsed != NULL ? &parsed[i] : NULL, &own, input, &lines[i], count, universe, &scratch);
+                if (result->status && insertToRelatioList(&result->relation, relations))
                 {
                     hasRorS++;
                     relations->relations[relations->relationList_len - 1].index = count;
                 }
-                else
-                {
-                    free(relation.items);
-                    return EXIT_FAILURE;
-                }
+                else return EXIT_FAILURE;
                 break;
             }
             case 'C':
@@ -2190,7 +4904,11 @@ int readFile(FILE *file, universe_t *universe, relationList_t *relations, setLis
                 hasC = 1;
                 if (!hasU || hasRorS < 1) return errMsg("Invalid file structure.\n", EXIT_FAILURE);
 
-                if (!readCommands(file, commands, count))
+                parsedLine_t *result = takeLine(parsed != NULL ? &parsed[i] : NULL, &own, input, &lines[i], count, universe, &scratch);
+                if (!result->status) return EXIT_FAILURE;
+
+                // a command whose arguments were not read is left out
+                if (result->commands.commandList_len > 0 && !insertIntoCommandList(commands, &result->command, count))
                 {
                     return EXIT_FAILURE;
                 }
@@ -2205,41 +4923,488 @@ int readFile(FILE *file, universe_t *universe, relationList_t *relations, setLis
     }
 
     if (!hasC) return errMsg("Invalid file structure.\n", EXIT_FAILURE);
-    printFile(universe, relations, sets);
-    return !execute(commands, sets, relations, universe, hasRorS, count);
+
+    *initSize = hasRorS;
+    *fileSize = count;
+    return EXIT_SUCCESS;
 }
 
-/// Parses input arguments and open file for reading
-/// \param argc number of command line arguments passed to the program
-/// \param argv list of the arguments passed
-/// \return 0 if the file is successfully opened and read
-/// \return EXIT_FAILURE when an error happens during reading or the program is run with invalid args
-int main(int argc, char **argv)
+/// Copies a section into the image of a compiled input, every section starts at an aligned offset
+/// \param image the image being built, NULL when only its size is computed
+/// \param pos the offset of the next section, advanced past this one
+/// \param data the data to be copied, NULL when the section is only reserved
+/// \param bytes size of the section
+/// \return the offset of the section
+uint64_t setcPut(char *image, size_t *pos, const void *data, size_t bytes)
+{
+    size_t offset = *pos;
+    if (image != NULL && data != NULL && bytes > 0) memcpy(image + offset, data, bytes);
+    *pos += arenaAlign(bytes);
+    return offset;
+}
+
+/// Lays out the parsed file as a compiled input, the records are written field by field
+/// with their pointers replaced by the offsets of the arrays they point to
+/// \param image the zeroed image to be filled, NULL when only its size is computed
+/// \param header the header whose offsets and counts are filled in
+/// \param universe the universe over which is everything defined
+/// \param relations list containing all relations in the file
+/// \param sets list containing all sets in the file
+/// \param commands list containing all commands in the file
+/// \return the size of the image
+size_t buildImage(char *image, setcHeader_t *header, universe_t *universe, relationList_t *relations, setList_t *sets, commandList_t *commands)
+{
+    size_t pos = arenaAlign(sizeof(setcHeader_t));
+
+    header->universe_len = universe->universe_len;
+    header->pool_len = universe->pool_len;
+    header->table_size = universe->table_size;
+    header->pool = setcPut(image, &pos, universe->pool, universe->pool_len);
+    header->offsets = setcPut(image, &pos, universe->offsets, universe->universe_len * sizeof(int));
+    header->lengths = setcPut(image, &pos, universe->lengths, universe->universe_len * sizeof(int));
+    header->hashes = setcPut(image, &pos, universe->hashes, universe->universe_len * sizeof(unsigned));
+    header->table = setcPut(image, &pos, universe->table, universe->table_size * sizeof(int));
+
+    header->setList_len = sets->setList_len;
+    header->sets = setcPut(image, &pos, NULL, sets->setList_len * sizeof(set_t));
+    for (int i = 0; i < sets->setList_len; i++)
+    {
+        uint64_t items = setcPut(image, &pos, sets->sets[i].items, sets->sets[i].set_len * sizeof(int));
+        if (image == NULL) continue;
+
+        set_t *set = (set_t *) (image + header->sets) + i;
+        set->items = (int *) (uintptr_t) items;
+        set->set_len = sets->sets[i].set_len;
+        set->index = sets->sets[i].index;
+    }
+
+    header->relationList_len = relations->relationList_len;
+    header->relations = setcPut(image, &pos, NULL, relations->relationList_len * sizeof(relation_t));
+    for (int i = 0; i < relations->relationList_len; i++)
+    {
+        uint64_t items = setcPut(image, &pos, relations->relations[i].items, relations->relations[i].relation_len * sizeof(relationUnit_t));
+        if (image == NULL) continue;
+
+        relation_t *relation = (relation_t *) (image + header->relations) + i;
+        relation->items = (relationUnit_t *) (uintptr_t) items;
+        relation->relation_len = relations->relations[i].relation_len;
+        relation->index = relations->relations[i].index;
+    }
+
+    header->commandList_len = commands->commandList_len;
+    header->commands = setcPut(image, &pos, NULL, commands->commandList_len * sizeof(command_t));
+    for (int i = 0; i < commands->commandList_len; i++)
+    {
+        // a command naming a line outside the file can never run, no argument count fits it once its parameters are
+        // left out, and the loader only accepts parameters naming lines of the file
+        int argc = commands->commands[i].argc;
+        for (int j = 0; j < commands->commands[i].argc; j++)
+        {
+            if (commands->commands[i].parameters[j] < 1 || commands->commands[i].parameters[j] > header->fileSize) argc = 0;
+        }
+
+        uint64_t parameters = setcPut(image, &pos, commands->commands[i].parameters, argc * sizeof(int));
+        if (image == NULL) continue;
+
+        command_t *command = (command_t *) (image + header->commands) + i;
+        command->functionNameIdx = commands->commands[i].functionNameIdx;
+        command->parameters = (int *) (uintptr_t) parameters;
+        command->argc = argc;
+        command->idx = commands->commands[i].idx;
+        command->exec = false;
+        command->morphed = false;
+    }
+
+    header->size = pos;
+    if (image != NULL) memcpy(image, header, sizeof(setcHeader_t));
+    return pos;
+}
+
+/// Writes the parsed file as a compiled input
+/// \param path path of the compiled file to be created
+/// \param universe the universe over which is everything defined
+/// \param relations list containing all relations in the file
+/// \param sets list containing all sets in the file
+/// \param commands list containing all commands in the file
+/// \param initSize the number of lines that are not command definitions
+/// \param fileSize the number of lines in the entire file
+/// \return EXIT_SUCCESS if the file is written, otherwise EXIT_FAILURE
+int writeCompiled(char *path, universe_t *universe, relationList_t *relations, setList_t *sets, commandList_t *commands, int initSize, int fileSize)
 {
+    setcHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SETC_MAGIC, sizeof(header.magic));
+    header.version = SETC_VERSION;
+    header.byteOrder = SETC_BYTE_ORDER;
+    header.pointerSize = sizeof(void *);
+    header.setSize = sizeof(set_t);
+    header.relationSize = sizeof(relation_t);
+    header.commandSize = sizeof(command_t);
+    header.initSize = initSize;
+    header.fileSize = fileSize;
+
+    // the first pass only measures the image, the second one fills it
+    size_t size = buildImage(NULL, &header, universe, relations, sets, commands);
+    char *image = bigBrainRealloc(NULL, size);
+    if (image == NULL) return errMsg("Allocation failed.\n", EXIT_FAILURE);
+
+    memset(image, 0, size);
+    buildImage(image, &header, universe, relations, sets, commands);
+
     FILE *f;
-    universe_t universe = {.universe_len = 0, .items = NULL};
-    relationList_t relations = {.relationList_len = 0, .relations = NULL};
-    setList_t sets = {.setList_len = 0, .sets = NULL};
-    commandList_t commands = {.commandList_len = 0, .commands = NULL};
+    if ((f = fopen(path, "wb")) == NULL)
+    {
+        fprintf(stderr, "Error opening file %s.\n", path);
+        return EXIT_FAILURE;
+    }
+
+    size_t written = fwrite(image, 1, size, f);
+    if (fclose(f) != 0 || written != size)
+        return errMsg("Error writing file.\n", EXIT_FAILURE);
+
+    return EXIT_SUCCESS;
+}
+
+/// Checks whether the input is a compiled one
+/// \param input the input buffer containing the file
+/// \return true when the input starts with the magic of a compiled input, false otherwise
+bool isCompiled(input_t *input)
+{
+    return input->len >= (long) sizeof(setcHeader_t) && memcmp(input->data, SETC_MAGIC, sizeof(SETC_MAGIC)) == 0;
+}
+
+/// Turns an offset stored in a compiled input into a pointer into the input buffer
+/// \param input the input buffer containing the compiled file
+/// \param offset the stored offset
+/// \param count number of items of the array
+/// \param itemSize size of a single item
+/// \param valid set to false when the array does not lie within the file
+/// \return pointer to the array, NULL for an empty array
+void *setcPointer(input_t *input, uint64_t offset, int32_t count, size_t itemSize, bool *valid)
+{
+    if (count == 0) return NULL;
+
+    if (count < 0 || offset % ARENA_ALIGN != 0 || offset > (uint64_t) input->len ||
+        (uint64_t) count * itemSize > (uint64_t) input->len - offset)
+    {
+        *valid = false;
+        return NULL;
+    }
+    return input->data + offset;
+}
+
+/// Loads a compiled input, the universe lives directly in the input buffer and the records
+/// of the lists are copied into growable arrays, their items stay in the input buffer
+/// \param input the input buffer containing the compiled file
+/// \param universe the universe over which is everything defined
+/// \param relations list containing all relations in the file
+/// \param sets list containing all sets in the file
+/// \param commands list containing all commands in the file
+/// \param initSize the number of lines that are not command definitions
+/// \param fileSize the number of lines in the entire file
+/// \return EXIT_SUCCESS if the compiled file is valid, otherwise EXIT_FAILURE
+int loadCompiled(input_t *input, universe_t *universe, relationList_t *relations, setList_t *sets, commandList_t *commands, int *initSize, int *fileSize)
+{
+    setcHeader_t *header = (setcHeader_t *) input->data;
+    if (header->version != SETC_VERSION || header->byteOrder != SETC_BYTE_ORDER)
+        return errMsg("Unsupported version of the compiled file.\n", EXIT_FAILURE);
+
+    if (header->pointerSize != sizeof(void *) || header->setSize != sizeof(set_t) ||
+        header->relationSize != sizeof(relation_t) || header->commandSize != sizeof(command_t))
+        return errMsg("The compiled file was created by an incompatible build.\n", EXIT_FAILURE);
+
+    bool valid = header->size == (uint64_t) input->len && header->universe_len >= 0 &&
+                 (header->table_size & (header->table_size - 1)) == 0 &&
+                 header->initSize >= 0 && header->fileSize <= MAX_NUM_LINES &&
+                 header->commandList_len == header->fileSize - header->initSize - 1;
+
+    universe->universe_len = universe->universe_cap = header->universe_len;
+    universe->pool_len = universe->pool_cap = header->pool_len;
+    universe->table_size = header->table_size;
+    universe->pool = setcPointer(input, header->pool, header->pool_len, sizeof(char), &valid);
+    universe->offsets = setcPointer(input, header->offsets, header->universe_len, sizeof(int), &valid);
+    universe->lengths = setcPointer(input, header->lengths, header->universe_len, sizeof(int), &valid);
+    universe->hashes = setcPointer(input, header->hashes, header->universe_len, sizeof(unsigned), &valid);
+    universe->table = setcPointer(input, header->table, header->table_size, sizeof(int), &valid);
+    if (!valid) return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+
+    // the items are checked the way the parser reads them, the output only reserves room for items it could read
+    for (int i = 0; i < universe->universe_len; i++)
+    {
+        if (universe->offsets[i] < 0 || universe->lengths[i] < 1 || universe->lengths[i] > MAX_STR_LEN ||
+            universe->lengths[i] >= universe->pool_len - universe->offsets[i] ||
+            universe->pool[universe->offsets[i] + universe->lengths[i]] != '\0')
+            return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+    }
+
+    // a full table would never end a lookup
+    bool freeSlot = universe->table_size == 0;
+    for (int i = 0; i < universe->table_size; i++)
+    {
+        if (universe->table[i] < EMPTY_SLOT || universe->table[i] >= universe->universe_len)
+            return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+        if (universe->table[i] == EMPTY_SLOT) freeSlot = true;
+    }
+    if (!freeSlot) return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+
+    // the operators rely on sets without duplicate items and relations without duplicate pairs
+    parseScratch_t scratch = {.seen = NULL, .pairs = NULL, .pairs_size = 0, .pairs_count = 0, .generation = 0};
+    if (universe->universe_len != 0)
+    {
+        int words = (universe->universe_len + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        scratch.seen = bigBrainRealloc(NULL, words * sizeof(uint64_t));
+        if (scratch.seen == NULL)
+            return errMsg("Allocation failed.\n", EXIT_FAILURE);
+        memset(scratch.seen, 0, words * sizeof(uint64_t));
+    }
 
-    if (argc == 2)
+    // the lists grow during the execution, so only their records are copied
+    set_t *storedSets = setcPointer(input, header->sets, header->setList_len, sizeof(set_t), &valid);
+    relation_t *storedRelations = setcPointer(input, header->relations, header->relationList_len, sizeof(relation_t), &valid);
+    command_t *storedCommands = setcPointer(input, header->commands, header->commandList_len, sizeof(command_t), &valid);
+    if (!valid) return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+
+    sets->sets = growArray(NULL, &sets->setList_cap, header->setList_len, sizeof(set_t));
+    relations->relations = growArray(NULL, &relations->relationList_cap, header->relationList_len, sizeof(relation_t));
+    commands->commands = growArray(NULL, &commands->commandList_cap, header->commandList_len, sizeof(command_t));
+    if ((sets->sets == NULL && header->setList_len > 0) ||
+        (relations->relations == NULL && header->relationList_len > 0) ||
+        (commands->commands == NULL && header->commandList_len > 0))
+        return errMsg("Allocation failed.\n", EXIT_FAILURE);
+
+    for (int i = 0; i < header->setList_len; i++)
     {
-        // try opening the file
-        if ((f = fopen(argv[1], "r")) != NULL)
+        set_t *set = &sets->sets[sets->setList_len++];
+        set->set_len = storedSets[i].set_len;
+        set->index = storedSets[i].index;
+        set->bits = NULL;
+        set->sorted = NULL;
+        set->chunks = NULL;
+        set->items = setcPointer(input, (uintptr_t) storedSets[i].items, set->set_len, sizeof(int), &valid);
+        if (set->set_len > universe->universe_len) valid = false;
+
+        int checked = 0;
+        for (; valid && checked < set->set_len; checked++)
         {
-            int status = readFile(f, &universe, &relations, &sets, &commands);
-            destructor(&universe, &relations, &sets, f, &commands);
-            return status;
+            int item = set->items[checked];
+            if (item < 0 || item >= universe->universe_len ||
+                (scratch.seen[item / BITS_PER_WORD] & (uint64_t) 1 << (item % BITS_PER_WORD)) != 0)
+                valid = false;
+            else
+                scratch.seen[item / BITS_PER_WORD] |= (uint64_t) 1 << (item % BITS_PER_WORD);
         }
-        else
+
+        // clear only the bits of this set, the items past a bad one were never marked
+        for (int j = 0; j < checked; j++)
+        {
+            if (set->items[j] >= 0 && set->items[j] < universe->universe_len) scratch.seen[set->items[j] / BITS_PER_WORD] = 0;
+        }
+        if (!valid) return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+        fingerprintSet(set);
+        if (!internSet(sets)) return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < header->relationList_len; i++)
+    {
+        relation_t *relation = &relations->relations[relations->relationList_len++];
+        relation->relation_len = storedRelations[i].relation_len;
+        relation->index = storedRelations[i].index;
+        relation->csr = NULL;
+        relation->items = setcPointer(input, (uintptr_t) storedRelations[i].items, relation->relation_len, sizeof(relationUnit_t), &valid);
+
+        // every relation is a new generation of the pair set, as every line is for the parser
+        scratch.generation++;
+        scratch.pairs_count = 0;
+        for (int j = 0; valid && j < relation->relation_len; j++)
+        {
+            if (relation->items[j].x < 0 || relation->items[j].x >= universe->universe_len ||
+                relation->items[j].y < 0 || relation->items[j].y >= universe->universe_len) valid = false;
+            else
+            {
+                int status = insertPair(&scratch, &relation->items[j]);
+                if (status == INVALID_INDEX) return EXIT_FAILURE;
+                valid = status;
+            }
+        }
+        if (!valid) return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+        if (!internRelation(relations)) return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < header->commandList_len; i++)
+    {
+        command_t *command = &commands->commands[commands->commandList_len++];
+        command->functionNameIdx = storedCommands[i].functionNameIdx;
+        command->argc = storedCommands[i].argc;
+        command->idx = storedCommands[i].idx;
+        command->exec = false;
+        command->morphed = false;
+        command->parameters = setcPointer(input, (uintptr_t) storedCommands[i].parameters, command->argc, sizeof(int), &valid);
+
+        if (command->idx < 1 || command->idx > header->fileSize) valid = false;
+        for (int j = 0; valid && j < command->argc; j++)
         {
-            fprintf(stderr, "Error opening file %s.\n", argv[1]);
-            return EXIT_FAILURE;
+            if (command->parameters[j] < 1 || command->parameters[j] > header->fileSize) valid = false;
         }
+        if (!valid || command->functionNameIdx < 0 || command->functionNameIdx >= COMBINED_FUNCTIONS_LASTINDEX)
+            return errMsg("Invalid compiled file.\n", EXIT_FAILURE);
+    }
+
+    *initSize = header->initSize;
+    *fileSize = header->fileSize;
+    return EXIT_SUCCESS;
+}
+
+/// Reads and executes a single input file, either a text or a compiled one, all memory used is taken from the arena
+/// \param path path to the file
+/// \param out the output the results are written to
+/// \param compilePath path of the compiled file to be written instead of executing the input, NULL to execute it
+/// \return 0 if the file is successfully opened and read
+/// \return EXIT_FAILURE when an error happens during reading
+int runFile(char *path, output_t *out, char *compilePath)
+{
+    FILE *f;
+    input_t input = {.data = NULL, .len = 0, .pos = 0};
+    universe_t universe = {.pool = NULL, .pool_len = 0, .pool_cap = 0, .offsets = NULL, .lengths = NULL,
+                           .universe_len = 0, .universe_cap = 0, .hashes = NULL, .table = NULL, .table_size = 0};
+    relationList_t relations = {.relationList_len = 0, .relationList_cap = 0, .relations = NULL,
+                                .intern = {.slots = NULL, .size = 0, .count = 0}};
+    setList_t sets = {.setList_len = 0, .setList_cap = 0, .sets = NULL, .intern = {.slots = NULL, .size = 0, .count = 0}};
+    commandList_t commands = {.commandList_len = 0, .commandList_cap = 0, .commands = NULL};
+    lineTable_t lines;
+
+    // try opening the file
+    if ((f = fopen(path, "rb")) == NULL)
+    {
+        fprintf(stderr, "Error opening file %s.\n", path);
+        return EXIT_FAILURE;
     }
+
+    int status = readInput(f, &input);
+    fclose(f);
+    if (!status) return EXIT_FAILURE;
+
+    int initSize, fileSize;
+    if (isCompiled(&input))
+        status = loadCompiled(&input, &universe, &relations, &sets, &commands, &initSize, &fileSize);
     else
+        status = readFile(&input, &universe, &relations, &sets, &commands, &initSize, &fileSize);
+    if (status != EXIT_SUCCESS) return status;
+
+    if (compilePath != NULL)
+        return writeCompiled(compilePath, &universe, &relations, &sets, &commands, initSize, fileSize);
+
+    program_t program;
+    buildLineTable(&lines, &commands, &sets, &relations);
+    if (!compileProgram(&program, &commands, &lines, initSize, fileSize)) return EXIT_FAILURE;
+
+    printFile(&universe, &relations, &sets, out);
+#ifdef THREADED_EXECUTE
+    if (threadCount > 1)
+    {
+        status = executeThreaded(&program, &commands, &sets, &relations, &universe, out);
+        if (status != EMPTY_INDEX) return !status;
+    }
+#endif
+    return !execute(&program, &commands, &lines, &sets, &relations, &universe, out);
+}
+
+/// Parses input arguments and runs all files passed, the arena is reset and reused between the files \n
+/// Usage: setcal [-o OUTPUT] [-c COMPILED] [-b bitmap|sorted|adaptive] [-e eager|lazy] [-j N] FILE... \n
+/// -j N is only taken by a build with SETCAL_THREADS
+/// \param argc number of command line arguments passed to the program
+/// \param argv list of the arguments passed
+/// \return 0 if all files are successfully opened and read
+/// \return EXIT_FAILURE when an error happens during reading or the program is run with invalid args
+int main(int argc, char **argv)
+{
+    output_t out = {.buf = NULL, .len = 0, .flushed = 0, .file = stdout};
+    char *outputPath = NULL, *compilePath = NULL;
+    int first = 1;
+
+    // options come in pairs in front of the input files
+    while (first + 1 < argc)
+    {
+        if (strcmp(argv[first], "-o") == 0) outputPath = argv[first + 1];
+        else if (strcmp(argv[first], "-c") == 0) compilePath = argv[first + 1];
+        else if (strcmp(argv[first], "-b") == 0 && strcmp(argv[first + 1], "bitmap") == 0) setBackend = BACKEND_BITMAP;
+        else if (strcmp(argv[first], "-b") == 0 && strcmp(argv[first + 1], "sorted") == 0) setBackend = BACKEND_SORTED;
+        else if (strcmp(argv[first], "-b") == 0 && strcmp(argv[first + 1], "adaptive") == 0) setBackend = BACKEND_ADAPTIVE;
+        else if (strcmp(argv[first], "-e") == 0 && strcmp(argv[first + 1], "eager") == 0) lazyEvaluation = false;
+        else if (strcmp(argv[first], "-e") == 0 && strcmp(argv[first + 1], "lazy") == 0) lazyEvaluation = true;
+#ifdef THREADED_EXECUTE
+        else if (strcmp(argv[first], "-j") == 0)
+        {
+            // a program never has more commands than lines to run at once
+            char *end;
+            long count = strtol(argv[first + 1], &end, 10);
+            if (end == argv[first + 1] || *end != '\0' || count < 1 || count > MAX_NUM_LINES) break;
+            threadCount = (int) count;
+        }
+#endif
+        else break;
+        first += 2;
+    }
+
+    // a compiled file holds exactly one input, an option that was not recognized is not taken for a file
+    bool invalid = argc <= first || (compilePath != NULL && argc != first + 1);
+    for (int i = first; i < argc; i++)
+    {
+        if (argv[i][0] == '-') invalid = true;
+    }
+    if (invalid)
     {
         fprintf(stderr, "Invalid arguments supplied.\n");
         return EXIT_FAILURE;
     }
+
+    if (outputPath != NULL && (out.file = fopen(outputPath, "w")) == NULL)
+    {
+        fprintf(stderr, "Error opening file %s.\n", outputPath);
+        return EXIT_FAILURE;
+    }
+
+#ifdef THREADED_EXECUTE
+    // every allocation asks for the arena of its thread, every error message for the line its thread parses
+    if (pthread_key_create(&arenaKey, NULL) != 0 || pthread_key_create(&messageKey, NULL) != 0)
+    {
+        if (out.file != stdout) fclose(out.file);
+        return errMsg("Allocation failed.\n", EXIT_FAILURE);
+    }
+#endif
+
+    // the output does its own buffering, every flush is a single write
+    setvbuf(out.file, NULL, _IONBF, 0);
+    out.buf = malloc(OUTPUT_BUFFER_SIZE);
+    if (out.buf == NULL)
+    {
+        if (out.file != stdout) fclose(out.file);
+        return errMsg("Allocation failed.\n", EXIT_FAILURE);
+    }
+
+    int status = 0;
+    for (int i = first; i < argc; i++)
+    {
+        if (runFile(argv[i], &out, compilePath) != 0) status = EXIT_FAILURE;
+        outFlush(&out);
+        arenaReset(&arena);
+    }
+
+#ifdef SETCAL_STATS
+    fprintf(stderr, "arena: %zu allocations from %zu blocks, peak %zu bytes\n",
+            arena.allocations, arena.blockCount, arena.peak);
+    fprintf(stderr, "containers: %zu arrays (%zu bytes), %zu bitmaps (%zu bytes), %zu runs (%zu bytes)\n",
+            containerCount[CONTAINER_ARRAY], containerBytes[CONTAINER_ARRAY],
+            containerCount[CONTAINER_BITMAP], containerBytes[CONTAINER_BITMAP],
+            containerCount[CONTAINER_RUN], containerBytes[CONTAINER_RUN]);
+    fprintf(stderr, "fingerprints: %zu comparisons decided by fingerprints, %zu compared exactly\n",
+            fingerprintDecided, fingerprintExact);
+    fprintf(stderr, "interned: %zu sets and %zu relations share the items of an identical one\n",
+            internedSets, internedRelations);
+    fprintf(stderr, "memo: %zu commands replayed, %zu computed\n", memoHits, memoMisses);
+#endif
+
+    free(out.buf);
+    if (out.file != stdout) fclose(out.file);
+    arenaRelease(&arena);
+    return status;
 }